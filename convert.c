@@ -0,0 +1,16 @@
+#include "graph.c"
+
+// convert <input> <output> turns a CSV instance, or a TSPLIB one when the
+// input ends with .tsp, into a binary instance for gra_map_binary.
+int main(int argc, char** argv) {
+        if (argc < 3) {
+                printf("Usage: %s <input.csv|input.tsp> <output>\n", argv[0]);
+                return 1;
+        }
+        const size_t length = strlen(argv[1]);
+        const int tsplib = length > 4 && strcmp(argv[1] + length - 4, ".tsp") == 0;
+        graph_t* graph = tsplib ? gra_read_tsplib(argv[1]) : gra_read(argv[1]);
+        gra_save_binary(argv[2], graph);
+        printf("%zu nodes written to %s\n", graph->size, argv[2]);
+        gra_destroy_graph(graph);
+}
@@ -1,36 +1,38 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pool.c"
 
 typedef unsigned int element_t;
 
-typedef unsigned short int bucket_t;
+typedef uint64_t bucket_t;
 
 typedef struct {
         size_t size;
         bucket_t* elements;
 } ensemble_t;
 
-#define ENS_ELEMENT_INDEX(element) element / (8 * sizeof(bucket_t))
-#define ENS_ELEMENT_SHIFT(element) 8 * sizeof(bucket_t) * (ENS_ELEMENT_INDEX(element))
+#define ENS_BUCKET_BITS 64
+#define ENS_ELEMENT_INDEX(element) ((element) >> 6)
+#define ENS_ELEMENT_BIT(element) ((element) & (ENS_BUCKET_BITS - 1))
+#define ENS_BUCKET_COUNT(size) (1 + ENS_ELEMENT_INDEX(size))
 
 ensemble_t* ens_create(const size_t size) {
-        ensemble_t* ensemble = calloc(1, sizeof(ensemble_t));
+        ensemble_t* ensemble = pool_calloc(1, sizeof(ensemble_t));
         ensemble->size = size;
-        ensemble->elements = calloc(1 + ENS_ELEMENT_INDEX(size), sizeof(bucket_t));
+        ensemble->elements = pool_calloc(ENS_BUCKET_COUNT(size), sizeof(bucket_t));
         return ensemble;
 }
 
+void ens_clear(ensemble_t* ensemble) {
+        memset(ensemble->elements, 0, ENS_BUCKET_COUNT(ensemble->size) * sizeof(bucket_t));
+}
+
 int ens_contains(const ensemble_t* ensemble, const element_t element) {
-        const bucket_t element_test = element - ENS_ELEMENT_SHIFT(element);
-        const size_t bucket_test = ENS_ELEMENT_INDEX(element);
-        const bucket_t mask_to_test = ((bucket_t) 1) << element_test;
-        // printf("    Element: %u\n", element);
-        // printf("Bit to test: %hu\n", element_test);
-        // printf("       Mask: %hu\n", mask_to_test);
-        // printf("  Bucket ID: %zu\n", bucket_test);
-        // printf("      Value: %hu\n", *(ensemble->elements + bucket_test));
-        return (*(ensemble->elements + bucket_test) & mask_to_test) > 0;
+        return (ensemble->elements[ENS_ELEMENT_INDEX(element)] >> ENS_ELEMENT_BIT(element)) & 1;
 }
 
 void ens_print(const ensemble_t* ensemble) {
@@ -49,16 +51,7 @@ void ens_print(const ensemble_t* ensemble) {
 }
 
 void ens_add_element(ensemble_t* ensemble, const element_t element) {
-        const bucket_t element_test = element - ENS_ELEMENT_SHIFT(element);
-        const size_t bucket_test = ENS_ELEMENT_INDEX(element);
-        const bucket_t mask_to_add = ((bucket_t) 1) << element_test;
-        // printf("    Element: %u\n", element);
-        // printf("Bit to test: %hu\n", element_test);
-        // printf("       Mask: %hu\n", mask_to_add);
-        // printf("  Bucket ID: %zu\n", bucket_test);
-        // printf("      Value: %hu\n", *(ensemble->elements + bucket_test));
-        *(ensemble->elements + bucket_test) |= mask_to_add;
-        // printf("      After: %hu\n", *(ensemble->elements + bucket_test));
+        ensemble->elements[ENS_ELEMENT_INDEX(element)] |= ((bucket_t) 1) << ENS_ELEMENT_BIT(element);
 }
 
 void ens_add_elements(ensemble_t* ensemble, const element_t* elements, const size_t size) {
@@ -68,10 +61,7 @@ void ens_add_elements(ensemble_t* ensemble, const element_t* elements, const siz
 }
 
 void ens_remove_element(ensemble_t* ensemble, const element_t element) {
-        const bucket_t element_test = element - ENS_ELEMENT_SHIFT(element);
-        const size_t bucket_test = ENS_ELEMENT_INDEX(element);
-        const bucket_t mask_to_remove = !(((bucket_t) 1) << element_test);
-        *(ensemble->elements + bucket_test) |= mask_to_remove;
+        ensemble->elements[ENS_ELEMENT_INDEX(element)] &= ~(((bucket_t) 1) << ENS_ELEMENT_BIT(element));
 }
 
 void ens_remove_elements(ensemble_t* ensemble, const element_t* elements, const size_t size) {
@@ -80,6 +70,51 @@ void ens_remove_elements(ensemble_t* ensemble, const element_t* elements, const
         }
 }
 
+// The bulk operations work a word at a time on ensembles of the same size.
+void ens_union(ensemble_t* ensemble, const ensemble_t* other) {
+        const size_t buckets = ENS_BUCKET_COUNT(ensemble->size);
+        for (size_t i=0 ; i<buckets ; i++) {
+                ensemble->elements[i] |= other->elements[i];
+        }
+}
+
+void ens_intersection(ensemble_t* ensemble, const ensemble_t* other) {
+        const size_t buckets = ENS_BUCKET_COUNT(ensemble->size);
+        for (size_t i=0 ; i<buckets ; i++) {
+                ensemble->elements[i] &= other->elements[i];
+        }
+}
+
+size_t ens_count(const ensemble_t* ensemble) {
+        const size_t buckets = ENS_BUCKET_COUNT(ensemble->size);
+        size_t count = 0;
+        for (size_t i=0 ; i<buckets ; i++) {
+                count += __builtin_popcountll(ensemble->elements[i]);
+        }
+        return count;
+}
+
+// Smallest element from `from` on, below the ensemble size, that is not in
+// the ensemble, skipping full buckets 64 elements at a time, or -1 when there
+// is none.
+element_t ens_first_missing(const ensemble_t* ensemble, const element_t from) {
+        const size_t buckets = ENS_BUCKET_COUNT(ensemble->size);
+        size_t index = ENS_ELEMENT_INDEX(from);
+        if (from >= ensemble->size) {
+                return -1;
+        }
+        bucket_t missing = ~ensemble->elements[index] & (~(bucket_t) 0 << ENS_ELEMENT_BIT(from));
+        while (missing == 0) {
+                if (++index == buckets) {
+                        return -1;
+                }
+                missing = ~ensemble->elements[index];
+        }
+        // the padding bits past the size are never set
+        const size_t element = index * ENS_BUCKET_BITS + __builtin_ctzll(missing);
+        return element < ensemble->size ? element : (element_t) -1;
+}
+
 ensemble_t* ens_of(const size_t element_count, ...) {
         va_list valist;
         va_start(valist, element_count);
@@ -92,7 +127,7 @@ ensemble_t* ens_of(const size_t element_count, ...) {
         }
         va_end(valist);
 
-        ensemble_t* ensemble = ens_create(max_element);
+        ensemble_t* ensemble = ens_create(max_element + 1);
         va_start(valist, element_count);
         for (size_t i = 0; i<element_count; i++) {
                 element_t current_element = va_arg(valist, element_t);
@@ -103,6 +138,6 @@ ensemble_t* ens_of(const size_t element_count, ...) {
 }
 
 void ens_destroy(ensemble_t* ensemble) {
-        free(ensemble->elements);
-        free(ensemble);
+        pool_free(ensemble->elements, ENS_BUCKET_COUNT(ensemble->size) * sizeof(bucket_t));
+        pool_free(ensemble, sizeof(ensemble_t));
 }
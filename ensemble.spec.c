@@ -26,20 +26,100 @@ void testLargeEnsemble() {
 void testFindBucket() {
         assert(ENS_ELEMENT_INDEX(0) == 0);
         assert(ENS_ELEMENT_INDEX(2) == 0);
-        assert(ENS_ELEMENT_INDEX(10) == 0);
-        assert(ENS_ELEMENT_INDEX(63) == 3);
-        assert(ENS_ELEMENT_INDEX(64) == 4);
-        assert(ENS_ELEMENT_INDEX(65) == 4);
-        assert(ENS_ELEMENT_INDEX(127) == 7);
-        assert(ENS_ELEMENT_INDEX(128) == 8);
-}
-
-void testBucketShift() {
-        assert(ENS_ELEMENT_SHIFT(0) == 0);
-        assert(ENS_ELEMENT_SHIFT(2) == 0);
-        assert(ENS_ELEMENT_SHIFT(10) == 0);
-        assert(ENS_ELEMENT_SHIFT(15) == 0);
-        assert(ENS_ELEMENT_SHIFT(16) == 16);
-        assert(ENS_ELEMENT_SHIFT(31) == 16);
-        assert(ENS_ELEMENT_SHIFT(32) == 32);
+        assert(ENS_ELEMENT_INDEX(63) == 0);
+        assert(ENS_ELEMENT_INDEX(64) == 1);
+        assert(ENS_ELEMENT_INDEX(127) == 1);
+        assert(ENS_ELEMENT_INDEX(128) == 2);
+}
+
+void testBucketBit() {
+        assert(ENS_ELEMENT_BIT(0) == 0);
+        assert(ENS_ELEMENT_BIT(10) == 10);
+        assert(ENS_ELEMENT_BIT(63) == 63);
+        assert(ENS_ELEMENT_BIT(64) == 0);
+        assert(ENS_ELEMENT_BIT(130) == 2);
+}
+
+void testRemoveElement() {
+        ensemble_t* ensemble = ens_of(3, 5, 63, 64);
+        ens_remove_element(ensemble, 63);
+        assert(!ens_contains(ensemble, 63));
+        assert(ens_contains(ensemble, 5));
+        assert(ens_contains(ensemble, 64));
+        ens_remove_element(ensemble, 63);
+        assert(ens_count(ensemble) == 2);
+        ens_clear(ensemble);
+        assert(ens_count(ensemble) == 0);
+        ens_destroy(ensemble);
+}
+
+void testBulkOperations() {
+        ensemble_t* evens = ens_create(300);
+        ensemble_t* thirds = ens_create(300);
+        for (element_t i=0 ; i<300 ; i++) {
+                if (i % 2 == 0) {
+                        ens_add_element(evens, i);
+                }
+                if (i % 3 == 0) {
+                        ens_add_element(thirds, i);
+                }
+        }
+        assert(ens_count(evens) == 150);
+        assert(ens_count(thirds) == 100);
+
+        ens_intersection(thirds, evens);
+        assert(ens_count(thirds) == 50);
+        assert(ens_contains(thirds, 294));
+        assert(!ens_contains(thirds, 297));
+
+        ens_union(evens, thirds);
+        assert(ens_count(evens) == 150);
+        ens_destroy(evens);
+        ens_destroy(thirds);
+}
+
+void testFirstMissing() {
+        ensemble_t* ensemble = ens_create(200);
+        assert(ens_first_missing(ensemble, 0) == 0);
+        for (element_t i=0 ; i<150 ; i++) {
+                ens_add_element(ensemble, i);
+        }
+        assert(ens_first_missing(ensemble, 0) == 150);
+        assert(ens_first_missing(ensemble, 149) == 150);
+        assert(ens_first_missing(ensemble, 170) == 170);
+        ens_remove_element(ensemble, 64);
+        assert(ens_first_missing(ensemble, 0) == 64);
+        assert(ens_first_missing(ensemble, 65) == 150);
+        ens_destroy(ensemble);
+
+        ensemble = ens_create(128);
+        for (element_t i=0 ; i<128 ; i++) {
+                ens_add_element(ensemble, i);
+        }
+        assert(ens_first_missing(ensemble, 3) == (element_t) -1);
+        ens_destroy(ensemble);
+
+        // a full ensemble whose last bucket has padding bits
+        ensemble = ens_create(200);
+        for (element_t i=0 ; i<200 ; i++) {
+                ens_add_element(ensemble, i);
+        }
+        assert(ens_first_missing(ensemble, 0) == (element_t) -1);
+        assert(ens_first_missing(ensemble, 197) == (element_t) -1);
+        assert(ens_first_missing(ensemble, 199) == (element_t) -1);
+        assert(ens_first_missing(ensemble, 200) == (element_t) -1);
+        ens_remove_element(ensemble, 198);
+        assert(ens_first_missing(ensemble, 197) == 198);
+        assert(ens_first_missing(ensemble, 199) == (element_t) -1);
+        ens_destroy(ensemble);
+}
+
+int main(int argc, char** argv) {
+        testSmallEnsemble();
+        testLargeEnsemble();
+        testFindBucket();
+        testBucketBit();
+        testRemoveElement();
+        testBulkOperations();
+        testFirstMissing();
 }
@@ -0,0 +1,163 @@
+#include "tsp.c"
+
+#define BENCH_GA_SIZE 1024
+#define BENCH_GA_GENERATIONS 20
+
+double bench_now() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Runs the same generations with 1 to max_threads threads. With a fixed seed
+// the best score must not depend on the number of threads.
+void bench_generations(const ga_parameters_t* parameters, const int max_threads) {
+        double reference = 0;
+        for (int threads=1 ; threads<=max_threads ; threads++) {
+                omp_set_num_threads(threads);
+                population_t* population = ga_generate_random_population(parameters);
+                ga_evaluate_population(parameters, population);
+
+                const double start = bench_now();
+                for (size_t generation=1 ; generation<=BENCH_GA_GENERATIONS ; generation++) {
+                        population_t* next_population = ga_generate_next_population(parameters, population, generation);
+                        ga_destroy_population(parameters, population);
+                        population = next_population;
+                        ga_evaluate_population(parameters, population);
+                }
+                const double elapsed = bench_now() - start;
+                if (threads == 1) {
+                        reference = elapsed;
+                }
+
+                printf("%3d threads %.2fms/generation, speedup %.2f, best %f\n", threads, elapsed * 1000 / BENCH_GA_GENERATIONS,
+                        reference / elapsed, population->individuals[0]->score);
+                ga_destroy_population(parameters, population);
+        }
+}
+
+#define BENCH_TARGET_GENERATIONS 40
+
+// Time for a single population and for islands of the same total size to
+// reach the length the single population gets after BENCH_TARGET_GENERATIONS.
+void bench_islands(const ga_parameters_t* parameters, const size_t island_count) {
+        ga_parameters_t single = *parameters;
+        single.verbose = 0;
+        single.max_generations = BENCH_TARGET_GENERATIONS;
+        double start = bench_now();
+        path_t* solution = ga_fit(&single);
+        const double single_elapsed = bench_now() - start;
+        const score_t target = path_length(parameters->graph, solution);
+        path_destroy(solution);
+        printf("single     %zu individuals reach %f in %.2fs\n", single.population_size, target, single_elapsed);
+
+        for (ga_migration_t migration=GA_MIGRATION_RING ; migration<=GA_MIGRATION_RANDOM ; migration++) {
+                ga_parameters_t islands = single;
+                islands.island_count = island_count;
+                islands.population_size = parameters->population_size / island_count;
+                islands.migration = migration;
+                islands.target_score = target;
+                islands.max_generations = 10 * BENCH_TARGET_GENERATIONS;
+                start = bench_now();
+                solution = ga_fit(&islands);
+                const double elapsed = bench_now() - start;
+                printf("%-10s %zu x %zu individuals reach %f in %.2fs, speedup %.2f\n", migration == GA_MIGRATION_RING ? "ring" : "random",
+                        island_count, islands.population_size, path_length(parameters->graph, solution), elapsed, single_elapsed / elapsed);
+                path_destroy(solution);
+        }
+
+        ga_parameters_t steady_state = single;
+        steady_state.steady_state = 1;
+        steady_state.selection = GA_SELECTION_TOURNAMENT;
+        steady_state.target_score = target;
+        steady_state.max_generations = 10 * BENCH_TARGET_GENERATIONS;
+        start = bench_now();
+        solution = ga_fit(&steady_state);
+        const double elapsed = bench_now() - start;
+        printf("steady     %zu individuals reach %f in %.2fs, speedup %.2f\n", steady_state.population_size,
+                path_length(parameters->graph, solution), elapsed, single_elapsed / elapsed);
+        path_destroy(solution);
+}
+
+#define BENCH_SELECTION_ROUNDS 20
+
+// Selector build plus two draws per individual, on populations of scores only.
+void bench_selection(const ga_selection_t selection, const char* label) {
+        ga_parameters_t parameters = tsp_parameters(NULL, 42);
+        parameters.selection = selection;
+        for (size_t size=1000 ; size<=1000000 ; size*=10) {
+                rng_t rng = rng_derive(42, -2, size);
+                population_t* population = ga_generate_empty_population(size);
+                for (size_t i=0 ; i<size ; i++) {
+                        population->individuals[i] = pool_calloc(1, sizeof(individual_t));
+                        population->individuals[i]->score = 1 + rng_probability(&rng);
+                }
+                ga_evaluate_population(&parameters, population);
+
+                size_t checksum = 0;
+                const double start = bench_now();
+                for (size_t round=0 ; round<BENCH_SELECTION_ROUNDS ; round++) {
+                        ga_selector_t* selector = ga_create_selector(&parameters, population, round);
+                        ga_stream_t stream = { rng, 0, 0 };
+                        for (size_t i=0 ; i<2 * size ; i++) {
+                                checksum += ga_select_index(selector, &stream);
+                        }
+                        ga_destroy_selector(selector);
+                }
+                const double elapsed = bench_now() - start;
+                printf("%-10s %8zu individuals %.1fns/draw (%zu)\n", label, size, elapsed * 1e9 / (BENCH_SELECTION_ROUNDS * 2 * size), checksum % 1000);
+
+                for (size_t i=0 ; i<size ; i++) {
+                        pool_free(population->individuals[i], sizeof(individual_t));
+                }
+                pool_free(population->ranks, size * sizeof(score_rank_t));
+                pool_free(population->individuals, size * sizeof(individual_t*));
+                pool_free(population, sizeof(population_t));
+        }
+}
+
+#define BENCH_CROSSOVER_SECONDS 20
+
+// Best length reached within the same time budget with each crossover.
+void bench_crossover(const ga_parameters_t* parameters, path_t* (*cross) (const graph_t*, const path_t*, const path_t*, rng_t*), const char* label) {
+        ga_parameters_t crossing = *parameters;
+        crossing.cross = cross;
+        population_t* population = ga_generate_random_population(&crossing);
+        ga_evaluate_population(&crossing, population);
+
+        const double start = bench_now();
+        size_t generation = 0;
+        while (bench_now() - start < BENCH_CROSSOVER_SECONDS) {
+                population_t* next_population = ga_generate_next_population(&crossing, population, ++generation);
+                ga_destroy_population(&crossing, population);
+                population = next_population;
+                ga_evaluate_population(&crossing, population);
+        }
+        const double elapsed = bench_now() - start;
+        printf("%-10s best %f after %zu generations in %.2fs, %.2fms/generation\n", label, population->individuals[0]->score,
+                generation, elapsed, elapsed * 1000 / generation);
+        ga_destroy_population(&crossing, population);
+}
+
+int main(int argc, char** argv) {
+        const int max_threads = argc > 1 ? atoi(argv[1]) : omp_get_max_threads();
+        rng_t rng = rng_derive(42, -1, 0);
+        graph_t* graph = gra_generate_random_graph(BENCH_GA_SIZE, &rng);
+        gra_build_neighbor_lists(graph, GRA_NEIGHBOR_COUNT);
+
+        ga_parameters_t parameters = tsp_parameters(graph, 42);
+        bench_generations(&parameters, max_threads);
+
+        omp_set_num_threads(max_threads);
+        bench_islands(&parameters, max_threads > 4 ? max_threads : 4);
+
+        bench_crossover(&parameters, tsp_cross_paths_neighbors, "neighbors");
+        bench_crossover(&parameters, tsp_cross_paths_partition, "partition");
+
+        bench_selection(GA_SELECTION_ROULETTE, "roulette");
+        bench_selection(GA_SELECTION_TOURNAMENT, "tournament");
+        bench_selection(GA_SELECTION_RANK, "rank");
+        bench_selection(GA_SELECTION_SUS, "sus");
+
+        gra_destroy_graph(graph);
+}
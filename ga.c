@@ -5,12 +5,15 @@
 #include <math.h>
 #include <assert.h>
 #include <float.h>
+#include <stddef.h>
 #include <omp.h>
 #include <signal.h>
 #include <time.h>
 
 #include "graph.c"
 #include "ponderation.c"
+#include "hashset.c"
+#include "transport.c"
 
 #ifndef GA_PROBLEM_TYPE
 #define GA_PROBLEM_TYPE graph_t
@@ -22,16 +25,39 @@
 
 typedef double score_t;
 
+// Individuals are immutable once scored and shared between populations:
+// survivors, elites and the best fit only take a reference.
 typedef struct {
         score_t score;
+        size_t references;
         GA_SOLUTION_TYPE* solution;
 } individual_t;
 
+typedef struct {
+        score_t score;
+        size_t index;
+} score_rank_t;
+
+// Once evaluated, the best individual is first and ranks holds every score
+// next to its slot, partially ordered by the percentile queries.
 typedef struct {
         size_t size;
         individual_t** individuals;
+        score_rank_t* ranks;
 } population_t;
 
+typedef enum {
+        GA_SELECTION_ROULETTE,
+        GA_SELECTION_TOURNAMENT,
+        GA_SELECTION_RANK,
+        GA_SELECTION_SUS
+} ga_selection_t;
+
+typedef enum {
+        GA_MIGRATION_RING,
+        GA_MIGRATION_RANDOM
+} ga_migration_t;
+
 typedef struct {
         GA_PROBLEM_TYPE* graph;
 
@@ -39,15 +65,46 @@ typedef struct {
         int elitism;
         probability_t survival_rate;
         probability_t mutation_rate;
-
-        GA_SOLUTION_TYPE* (*generate) (const GA_PROBLEM_TYPE*);
+        uint64_t seed;
+
+        ga_selection_t selection;
+        size_t tournament_size;
+        // expected draws of the best individual in linear rank selection, between 1 and 2
+        probability_t selection_pressure;
+
+        // ga_fit stops once the best score reaches target_score, or after
+        // max_generations when it is not 0
+        score_t target_score;
+        size_t max_generations;
+        int verbose;
+
+        // with more than one island, each one evolves its own population and
+        // sends its migrant_count best individuals every migration_interval
+        // generations
+        size_t island_count;
+        size_t migration_interval;
+        size_t migrant_count;
+        ga_migration_t migration;
+        // when set, this process is one island of transport->count processes
+        transport_t* transport;
+        // threads replace individuals one child at a time instead of building
+        // whole generations, max_generations then counts population_size children
+        int steady_state;
+
+        GA_SOLUTION_TYPE* (*generate) (const GA_PROBLEM_TYPE*, rng_t*);
         void (*regularize) (const GA_PROBLEM_TYPE*, GA_SOLUTION_TYPE*);
         int (*compare) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*, const GA_SOLUTION_TYPE*);
+        uint64_t (*hash) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*);
         score_t (*evaluate) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*);
         GA_SOLUTION_TYPE* (*copy) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*);
-        GA_SOLUTION_TYPE* (*cross) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*, const GA_SOLUTION_TYPE*);
-        void (*mutate) (const GA_PROBLEM_TYPE*, GA_SOLUTION_TYPE*);
+        GA_SOLUTION_TYPE* (*cross) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*, const GA_SOLUTION_TYPE*, rng_t*);
+        void (*mutate) (const GA_PROBLEM_TYPE*, GA_SOLUTION_TYPE*, rng_t*);
         void (*destroy) (GA_SOLUTION_TYPE*);
+        // writes the solution in a compact binary form and returns its size,
+        // or only returns the size when buffer is NULL
+        size_t (*serialize) (const GA_PROBLEM_TYPE*, const GA_SOLUTION_TYPE*, void* buffer);
+        // returns NULL when the buffer does not hold a valid solution
+        GA_SOLUTION_TYPE* (*deserialize) (const GA_PROBLEM_TYPE*, const void* buffer, size_t size);
 
 } ga_parameters_t;
 
@@ -63,162 +120,398 @@ score_t ga_evaluate_individual_score(const ga_parameters_t* parameters, individu
         return individual->score;
 }
 
-individual_t* ga_generate_random_individual(const ga_parameters_t* parameters) {
-        individual_t* individual = calloc(1, sizeof(individual_t));
+individual_t* ga_generate_random_individual(const ga_parameters_t* parameters, rng_t* rng) {
+        individual_t* individual = pool_calloc(1, sizeof(individual_t));
         individual->score = -1;
-        individual->solution = parameters->generate(parameters->graph);
+        individual->references = 1;
+        individual->solution = parameters->generate(parameters->graph, rng);
         ga_regularize_individual(parameters, individual);
         ga_evaluate_individual_score(parameters, individual);
         return individual;
 }
 
-size_t ga_individual_index(const ga_parameters_t* parameters, const population_t* population, const individual_t* individual) {
-        for (size_t i=0 ; i<population->size ; i++) {
-                if (population->individuals[i] == NULL) {
-                        return -1;
-                } else if (parameters->compare(parameters->graph, population->individuals[i]->solution, individual->solution)==0) {
-                        return i;
-                }
-        }
-        return -1;
+individual_t* ga_share_individual(const individual_t* individual) {
+        individual_t* shared = (individual_t*) individual;
+        __atomic_fetch_add(&shared->references, 1, __ATOMIC_RELAXED);
+        return shared;
 }
 
-population_t* ga_generate_empty_population(const size_t size) {
-        population_t* population = calloc(1, sizeof(population_t));
-        population->size = size;
-        population->individuals = calloc(population->size, sizeof(individual_t*));
-        return population;
+void ga_release_individual(const ga_parameters_t* parameters, individual_t* individual) {
+        if (__atomic_sub_fetch(&individual->references, 1, __ATOMIC_ACQ_REL) > 0) {
+                return;
+        }
+        parameters->destroy(individual->solution);
+        pool_free(individual, sizeof(individual_t));
 }
 
-population_t* ga_generate_random_population(const ga_parameters_t* parameters) {
-        population_t* population = ga_generate_empty_population(parameters->population_size);
-
-        size_t i;
-        #pragma omp parallel for
-        for (i=0 ; i<population->size ; i++) {
-                // printf("individual %lu on thread %d\n", i, omp_get_thread_num());
-                population->individuals[i] = ga_generate_random_individual(parameters);
-                if (ga_individual_index(parameters, population, population->individuals[i]) != i) {
-                        i--;
-                }
-        }
-        return population;
+int ga_same_individuals(const void* parameters, const void* individual1, const void* individual2) {
+        const ga_parameters_t* ga_parameters = parameters;
+        return ga_parameters->compare(ga_parameters->graph, ((const individual_t*) individual1)->solution, ((const individual_t*) individual2)->solution) == 0;
 }
 
-void ga_destroy_individual(const ga_parameters_t* parameters, individual_t* individual) {
-        parameters->destroy(individual->solution);
-        free(individual);
+// Registers the individual in the set of solutions of its population, returns
+// 0 if an identical solution was already there.
+int ga_register_individual(const ga_parameters_t* parameters, hashset_t* solutions, const individual_t* individual, const uint64_t hash) {
+        return hset_insert(solutions, hash, individual, ga_same_individuals, parameters) == NULL;
 }
 
 void ga_destroy_population(const ga_parameters_t* parameters, population_t* population) {
-        for (size_t i=0 ; i<population->size ; i++) {
-                ga_destroy_individual(parameters, population->individuals[i]);
+        // individuals go back to the pools of the threads that will build the next ones
+        size_t i;
+        #pragma omp parallel for schedule(static)
+        for (i=0 ; i<population->size ; i++) {
+                ga_release_individual(parameters, population->individuals[i]);
         }
-        free(population->individuals);
-        free(population);
+        pool_free(population->ranks, population->size * sizeof(score_rank_t));
+        pool_free(population->individuals, population->size * sizeof(individual_t*));
+        pool_free(population, sizeof(population_t));
 }
 
 individual_t* ga_copy_individual(const ga_parameters_t* parameters, const individual_t* individual) {
-        individual_t* copy = calloc(1, sizeof(individual_t));
+        individual_t* copy = pool_calloc(1, sizeof(individual_t));
         copy->score = individual->score;
+        copy->references = 1;
         copy->solution = parameters->copy(parameters->graph, individual->solution);
         return copy;
 }
 
-int ga_compare_individuals(const void* a, const void* b) {
-        score_t score_a = (*(individual_t**) a)->score;
-        score_t score_b = (*(individual_t**) b)->score;
-        score_t diff = score_a - score_b;
-        if (diff < 0) {
-                return -1;
+int ga_compare_ranks(const void* a, const void* b) {
+        const score_rank_t* rank_a = a;
+        const score_rank_t* rank_b = b;
+        if (rank_a->score != rank_b->score) {
+                return rank_a->score < rank_b->score ? -1 : 1;
         }
-        if (diff > 0) {
-                return 1;
+        return rank_a->index < rank_b->index ? -1 : rank_a->index > rank_b->index;
+}
+
+void ga_swap_ranks(score_rank_t* ranks, const size_t i, const size_t j) {
+        const score_rank_t rank = ranks[i];
+        ranks[i] = ranks[j];
+        ranks[j] = rank;
+}
+
+// Reorders ranks[from..to) so that ranks[k] is the one a full sort would put
+// there, with no greater rank before it and no smaller one after it.
+void ga_select_rank(score_rank_t* ranks, size_t from, size_t to, const size_t k) {
+        while (to - from > 1) {
+                const size_t middle = from + (to - from) / 2;
+                if (ga_compare_ranks(ranks + middle, ranks + from) < 0) {
+                        ga_swap_ranks(ranks, middle, from);
+                }
+                if (ga_compare_ranks(ranks + to - 1, ranks + from) < 0) {
+                        ga_swap_ranks(ranks, to - 1, from);
+                }
+                if (ga_compare_ranks(ranks + to - 1, ranks + middle) < 0) {
+                        ga_swap_ranks(ranks, to - 1, middle);
+                }
+                const score_rank_t pivot = ranks[middle];
+                ptrdiff_t i = from;
+                ptrdiff_t j = to - 1;
+                while (i <= j) {
+                        while (ga_compare_ranks(ranks + i, &pivot) < 0) {
+                                i++;
+                        }
+                        while (ga_compare_ranks(ranks + j, &pivot) > 0) {
+                                j--;
+                        }
+                        if (i <= j) {
+                                ga_swap_ranks(ranks, i++, j--);
+                        }
+                }
+                if ((ptrdiff_t) k <= j) {
+                        to = j + 1;
+                } else if ((ptrdiff_t) k >= i) {
+                        from = i;
+                } else {
+                        return;
+                }
         }
-        return 0;
 }
 
+// Score of the individual that would be at position k once sorted, in O(size).
+score_t ga_population_rank_score(const population_t* population, const size_t k) {
+        ga_select_rank(population->ranks, 0, population->size, k);
+        return population->ranks[k].score;
+}
+
+// Moves the best individual first and gathers the scores. The rest of the
+// population is left unsorted.
 void ga_evaluate_population(const ga_parameters_t* parameters, population_t* population) {
-        qsort(population->individuals, population->size, sizeof(individual_t*), ga_compare_individuals);
+        size_t best = 0;
+        for (size_t i=1 ; i<population->size ; i++) {
+                if (population->individuals[i]->score < population->individuals[best]->score) {
+                        best = i;
+                }
+        }
+        individual_t* best_individual = population->individuals[best];
+        population->individuals[best] = population->individuals[0];
+        population->individuals[0] = best_individual;
+
+        for (size_t i=0 ; i<population->size ; i++) {
+                population->ranks[i].score = population->individuals[i]->score;
+                population->ranks[i].index = i;
+        }
 }
 
-individual_t* ga_cross_individuals(const ga_parameters_t* parameters, const individual_t* parent1, const individual_t* parent2) {
-        individual_t* child = calloc(1, sizeof(individual_t));
+// Fully sorts the population by score, for the strategies that need ranks.
+void ga_sort_population(population_t* population) {
+        qsort(population->ranks, population->size, sizeof(score_rank_t), ga_compare_ranks);
+        individual_t** sorted = pool_calloc(population->size, sizeof(individual_t*));
+        for (size_t i=0 ; i<population->size ; i++) {
+                sorted[i] = population->individuals[population->ranks[i].index];
+                population->ranks[i].index = i;
+        }
+        memcpy(population->individuals, sorted, population->size * sizeof(individual_t*));
+        pool_free(sorted, population->size * sizeof(individual_t*));
+}
+
+individual_t* ga_cross_individuals(const ga_parameters_t* parameters, const individual_t* parent1, const individual_t* parent2, rng_t* rng) {
+        individual_t* child = pool_calloc(1, sizeof(individual_t));
         child->score = -1;
-        child->solution = parameters->cross(parameters->graph, parent1->solution, parent2->solution);
+        child->references = 1;
+        child->solution = parameters->cross(parameters->graph, parent1->solution, parent2->solution, rng);
         ga_regularize_individual(parameters, child);
         ga_evaluate_individual_score(parameters, child);
         return child;
 }
 
-const individual_t* ga_select_individual(const population_t* population, const ponderation_t* ponderation) {
-        const size_t random_index = pond_random(ponderation);
-        return population->individuals[random_index];
+// Per generation state of the selection strategy, shared read-only by the
+// threads: the alias table of the roulette, or the systematic samples of SUS.
+typedef struct {
+        const ga_parameters_t* parameters;
+        const population_t* population;
+        ponderation_t* ponderation;
+        size_t* samples;
+        size_t sample_count;
+} ga_selector_t;
+
+// Random stream of a slot, which first draws the SUS samples sample..sample_end.
+typedef struct {
+        rng_t rng;
+        size_t sample;
+        size_t sample_end;
+} ga_stream_t;
+
+// Stochastic universal sampling: sample_count equally spaced pointers over the
+// cumulated weights, handed out in a shuffled order.
+void ga_sample_universally(ga_selector_t* selector, rng_t* rng) {
+        const population_t* population = selector->population;
+        score_t total = 0;
+        for (size_t i=0 ; i<population->size ; i++) {
+                total += 1 / population->individuals[i]->score;
+        }
+        const score_t step = total / selector->sample_count;
+        score_t pointer = rng_probability(rng) * step;
+        score_t cumulated = 1 / population->individuals[0]->score;
+        size_t individual = 0;
+        for (size_t i=0 ; i<selector->sample_count ; i++, pointer += step) {
+                while (pointer >= cumulated && individual + 1 < population->size) {
+                        cumulated += 1 / population->individuals[++individual]->score;
+                }
+                selector->samples[i] = individual;
+        }
+        for (size_t i=selector->sample_count - 1 ; i>0 ; i--) {
+                const size_t j = rng_below(rng, i + 1);
+                const size_t sample = selector->samples[i];
+                selector->samples[i] = selector->samples[j];
+                selector->samples[j] = sample;
+        }
+}
+
+// Builds what the selection strategy needs for a generation: nothing for
+// tournaments, a sort for linear ranking, O(size) tables for the others.
+ga_selector_t* ga_create_selector(const ga_parameters_t* parameters, population_t* population, const size_t generation) {
+        ga_selector_t* selector = pool_calloc(1, sizeof(ga_selector_t));
+        selector->parameters = parameters;
+        selector->population = population;
+        if (parameters->selection == GA_SELECTION_ROULETTE) {
+                selector->ponderation = pond_create(population->size);
+                for (size_t i=0 ; i<population->size ; i++) {
+                        pond_set_probability(selector->ponderation, i, 1 / population->individuals[i]->score);
+                }
+                pond_finalize(selector->ponderation);
+        } else if (parameters->selection == GA_SELECTION_RANK) {
+                ga_sort_population(population);
+        } else if (parameters->selection == GA_SELECTION_SUS) {
+                rng_t rng = rng_derive(parameters->seed, generation, -1);
+                selector->sample_count = 2 * population->size;
+                selector->samples = pool_calloc(selector->sample_count, sizeof(size_t));
+                ga_sample_universally(selector, &rng);
+        }
+        return selector;
+}
+
+void ga_destroy_selector(ga_selector_t* selector) {
+        if (selector->ponderation != NULL) {
+                pond_destroy(selector->ponderation);
+        }
+        pool_free(selector->samples, selector->sample_count * sizeof(size_t));
+        pool_free(selector, sizeof(ga_selector_t));
+}
+
+size_t ga_select_index(const ga_selector_t* selector, ga_stream_t* stream) {
+        const size_t size = selector->population->size;
+        switch (selector->parameters->selection) {
+                case GA_SELECTION_TOURNAMENT: {
+                        size_t best = rng_below(&stream->rng, size);
+                        for (size_t i=1 ; i<selector->parameters->tournament_size ; i++) {
+                                const size_t challenger = rng_below(&stream->rng, size);
+                                if (selector->population->individuals[challenger]->score < selector->population->individuals[best]->score) {
+                                        best = challenger;
+                                }
+                        }
+                        return best;
+                }
+                case GA_SELECTION_RANK: {
+                        // mixing uniform ranks with the best of two uniform ranks gives
+                        // probabilities decreasing linearly from pressure / size
+                        const size_t rank = rng_below(&stream->rng, size);
+                        if (rng_probability(&stream->rng) < selector->parameters->selection_pressure - 1) {
+                                const size_t other = rng_below(&stream->rng, size);
+                                return rank < other ? rank : other;
+                        }
+                        return rank;
+                }
+                case GA_SELECTION_SUS:
+                        if (stream->sample < stream->sample_end) {
+                                return selector->samples[stream->sample++];
+                        }
+                        return selector->samples[rng_below(&stream->rng, selector->sample_count)];
+                default:
+                        return pond_random(selector->ponderation, &stream->rng);
+        }
+}
+
+const individual_t* ga_select_individual(const ga_selector_t* selector, ga_stream_t* stream) {
+        return selector->population->individuals[ga_select_index(selector, stream)];
 }
 
-void ga_mutate(const ga_parameters_t* parameters, GA_SOLUTION_TYPE* solution) {
-        parameters->mutate(parameters->graph, solution);
+// Mutates the individual, or a copy of it when it is shared, and returns the
+// mutated one.
+individual_t* ga_mutate(const ga_parameters_t* parameters, individual_t* individual, rng_t* rng) {
+        if (__atomic_load_n(&individual->references, __ATOMIC_ACQUIRE) > 1) {
+                individual_t* copy = ga_copy_individual(parameters, individual);
+                ga_release_individual(parameters, individual);
+                individual = copy;
+        }
+        parameters->mutate(parameters->graph, individual->solution, rng);
+        // mutations maintain the neighborhood length, so scoring again is O(1)
+        individual->score = -1;
+        ga_regularize_individual(parameters, individual);
+        ga_evaluate_individual_score(parameters, individual);
+        return individual;
 }
 
-individual_t* ga_generate_individual(const ga_parameters_t* parameters, const population_t* population, const ponderation_t* score_ponderation) {
-        if (random_probability() < parameters->survival_rate) {
-                return ga_copy_individual(parameters, ga_select_individual(population, score_ponderation));
+individual_t* ga_generate_individual(const ga_parameters_t* parameters, const ga_selector_t* selector, ga_stream_t* stream) {
+        rng_t* rng = &stream->rng;
+        if (rng_probability(rng) < parameters->survival_rate) {
+                return ga_share_individual(ga_select_individual(selector, stream));
         }
 
-        const individual_t* parent1 = ga_select_individual(population, score_ponderation);
-        const individual_t* parent2 = ga_select_individual(population, score_ponderation);
-        individual_t* child = ga_cross_individuals(parameters, parent1, parent2);
+        const individual_t* parent1 = ga_select_individual(selector, stream);
+        const individual_t* parent2 = ga_select_individual(selector, stream);
+        individual_t* child = ga_cross_individuals(parameters, parent1, parent2, rng);
 
-        if (random_probability() < parameters->mutation_rate) {
-                ga_mutate(parameters, child->solution);
+        if (rng_probability(rng) < parameters->mutation_rate) {
+                child = ga_mutate(parameters, child, rng);
         }
 
         return child;
 }
 
-population_t* ga_generate_next_population(const ga_parameters_t* parameters, const population_t* population) {
-        ponderation_t* score_ponderation = pond_create(parameters->population_size);
-        for (size_t i=0 ; i<population->size ; i++) {
-                pond_set_probability(score_ponderation, i, 1 / population->individuals[i]->score);
+// Fills the empty slots of the population, with random individuals when there
+// is no selector. Each slot owns its random stream and is only written by the
+// thread building it. Candidates are built in parallel, then registered in slot
+// order, so the same slots lose the same duplicates whatever the number of
+// threads; losers are rebuilt in the next round.
+void ga_fill_population(const ga_parameters_t* parameters, population_t* population, const ga_selector_t* selector, const size_t generation) {
+        const size_t size = population->size;
+        hashset_t* solutions = hset_create(size);
+        ga_stream_t* streams = pool_calloc(size, sizeof(ga_stream_t));
+        uint64_t* hashes = pool_calloc(size, sizeof(uint64_t));
+        size_t* pending = pool_calloc(size, sizeof(size_t));
+        size_t pending_count = 0;
+
+        for (size_t i=0 ; i<size ; i++) {
+                if (population->individuals[i] != NULL) {
+                        hashes[i] = parameters->hash(parameters->graph, population->individuals[i]->solution);
+                        ga_register_individual(parameters, solutions, population->individuals[i], hashes[i]);
+                } else {
+                        streams[i].rng = rng_derive(parameters->seed, generation, i);
+                        if (selector != NULL && selector->sample_count > 0) {
+                                streams[i].sample = selector->sample_count * i / size;
+                                streams[i].sample_end = selector->sample_count * (i + 1) / size;
+                        }
+                        pending[pending_count++] = i;
+                }
         }
 
-        population_t* next_population = ga_generate_empty_population(parameters->population_size);
+        while (pending_count > 0) {
+                size_t p;
+                #pragma omp parallel for schedule(static)
+                for (p=0 ; p<pending_count ; p++) {
+                        const size_t slot = pending[p];
+                        if (population->individuals[slot] != NULL) {
+                                ga_release_individual(parameters, population->individuals[slot]);
+                        }
+                        individual_t* individual = selector == NULL
+                                ? ga_generate_random_individual(parameters, &streams[slot].rng)
+                                : ga_generate_individual(parameters, selector, streams + slot);
+                        hashes[slot] = parameters->hash(parameters->graph, individual->solution);
+                        population->individuals[slot] = individual;
+                }
 
-        if (parameters->elitism) {
-                next_population->individuals[0] = ga_copy_individual(parameters, population->individuals[0]);
+                size_t rejected = 0;
+                for (p=0 ; p<pending_count ; p++) {
+                        const size_t slot = pending[p];
+                        if (!ga_register_individual(parameters, solutions, population->individuals[slot], hashes[slot])) {
+                                pending[rejected++] = slot;
+                        }
+                }
+                pending_count = rejected;
         }
 
-        size_t i;
-        #pragma omp parallel for
-        for (i = parameters->elitism ? 1 : 0 ; i<parameters->population_size ; i++) {
-                // printf("individual %lu on thread %d\n", i, omp_get_thread_num());
-                do {
-                        individual_t* individual = ga_generate_individual(parameters, population, score_ponderation);
-                        for (size_t j=0 ; j<next_population->size && individual!=NULL ; j++) {
-                                if (next_population->individuals[j] != NULL) {
-                                        int comparaison = parameters->compare(parameters->graph, next_population->individuals[j]->solution, individual->solution);
-                                        if (comparaison == 0) {
-                                                ga_destroy_individual(parameters, individual);
-                                                individual = NULL;
-                                        }
-                                }
-                        }
-                        next_population->individuals[i] = individual;
-                } while (next_population->individuals[i] == NULL);
+        pool_free(pending, size * sizeof(size_t));
+        pool_free(hashes, size * sizeof(uint64_t));
+        pool_free(streams, size * sizeof(ga_stream_t));
+        hset_destroy(solutions);
+}
+
+population_t* ga_generate_empty_population(const size_t size) {
+        population_t* population = pool_calloc(1, sizeof(population_t));
+        population->size = size;
+        population->individuals = pool_calloc(population->size, sizeof(individual_t*));
+        population->ranks = pool_calloc(population->size, sizeof(score_rank_t));
+        return population;
+}
+
+population_t* ga_generate_random_population(const ga_parameters_t* parameters) {
+        population_t* population = ga_generate_empty_population(parameters->population_size);
+        ga_fill_population(parameters, population, NULL, 0);
+        return population;
+}
+
+population_t* ga_generate_next_population(const ga_parameters_t* parameters, population_t* population, const size_t generation) {
+        ga_selector_t* selector = ga_create_selector(parameters, population, generation);
+        population_t* next_population = ga_generate_empty_population(parameters->population_size);
+
+        if (parameters->elitism) {
+                next_population->individuals[0] = ga_share_individual(population->individuals[0]);
         }
+        ga_fill_population(parameters, next_population, selector, generation);
 
-        pond_destroy(score_ponderation);
+        ga_destroy_selector(selector);
         return next_population;
 }
 
-void ga_print_population(const GA_PROBLEM_TYPE* graph, const population_t* population) {
-        printf("Population %p[size=%zu,min=%f,90th=%f,75th=%f,med=%f,25th=%f,max=%f]\n", population, population->size,
+void ga_print_population(const GA_PROBLEM_TYPE* graph, population_t* population, const size_t allocations) {
+        printf("Population %p[size=%zu,allocations=%zu,min=%f,90th=%f,75th=%f,med=%f,25th=%f,max=%f]\n", population, population->size, allocations,
                 population->individuals[0]->score,
-                population->individuals[population->size / 10]->score,
-                population->individuals[population->size / 4]->score,
-                population->individuals[population->size / 2]->score,
-                population->individuals[population->size * 3 / 4]->score,
-                population->individuals[population->size - 1]->score);
+                ga_population_rank_score(population, population->size / 10),
+                ga_population_rank_score(population, population->size / 4),
+                ga_population_rank_score(population, population->size / 2),
+                ga_population_rank_score(population, population->size * 3 / 4),
+                ga_population_rank_score(population, population->size - 1));
 }
 
 int ga_interrupted = 0;
@@ -227,33 +520,494 @@ void ga_interrupt(int sig) {
         ga_interrupted = 1;
 }
 
-GA_SOLUTION_TYPE* ga_fit(const ga_parameters_t* parameters) {
-        signal(SIGINT, ga_interrupt);
+int ga_finished(const ga_parameters_t* parameters, const individual_t* best_fit, const size_t generation) {
+        return ga_interrupted
+                || (parameters->max_generations > 0 && generation >= parameters->max_generations)
+                || (best_fit != NULL && best_fit->score <= parameters->target_score);
+}
+
+void ga_keep_best_fit(const ga_parameters_t* parameters, individual_t** best_fit, const individual_t* candidate) {
+        if (*best_fit == NULL || candidate->score < (*best_fit)->score) {
+                if (*best_fit != NULL) {
+                        ga_release_individual(parameters, *best_fit);
+                }
+                *best_fit = ga_share_individual(candidate);
+        }
+}
+
+GA_SOLUTION_TYPE* ga_finish(const ga_parameters_t* parameters, individual_t* best_fit) {
+        GA_SOLUTION_TYPE* solution = parameters->copy(parameters->graph, best_fit->solution);
+        ga_release_individual(parameters, best_fit);
+        #pragma omp parallel
+        pool_release();
+        return solution;
+}
 
+typedef struct {
+        ga_parameters_t parameters;
+        population_t* population;
+} ga_island_t;
+
+void ga_evolve_island(ga_island_t* island, const size_t first_generation, const size_t count) {
+        for (size_t generation=first_generation ; generation<first_generation + count ; generation++) {
+                population_t* next_population = ga_generate_next_population(&island->parameters, island->population, generation);
+                ga_destroy_population(&island->parameters, island->population);
+                island->population = next_population;
+                ga_evaluate_population(&island->parameters, island->population);
+        }
+}
+
+int ga_population_contains(const ga_parameters_t* parameters, const population_t* population, const individual_t* individual) {
+        for (size_t i=0 ; i<population->size ; i++) {
+                const individual_t* current = population->individuals[i];
+                if (current->score == individual->score && parameters->compare(parameters->graph, current->solution, individual->solution) == 0) {
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+size_t ga_migrant_count(const ga_parameters_t* parameters, const size_t size) {
+        return parameters->migrant_count < size / 2 ? parameters->migrant_count : size / 2;
+}
+
+// Moves the ranks of the migrant_count best individuals first.
+void ga_select_emigrants(population_t* population, const size_t migrant_count) {
+        ga_select_rank(population->ranks, 0, population->size, migrant_count - 1);
+}
+
+// Migrants replace the worst individuals of the population, and are released
+// when they are not better or already there. Ranks are updated, so that later
+// migrants never replace earlier ones. Returns the number of migrants adopted.
+size_t ga_immigrate(const ga_parameters_t* parameters, population_t* population, individual_t** migrants, const size_t migrant_count) {
+        const size_t size = population->size;
+        const size_t count = migrant_count < size / 2 ? migrant_count : size / 2;
+        size_t adopted = 0;
+        if (count > 0) {
+                ga_select_rank(population->ranks, 0, size, size - count);
+        }
+        for (size_t m=0 ; m<migrant_count ; m++) {
+                individual_t* migrant = migrants[m];
+                score_rank_t* rank = population->ranks + size - 1 - (m < count ? m : 0);
+                if (m >= count || migrant->score >= rank->score || ga_population_contains(parameters, population, migrant)) {
+                        ga_release_individual(parameters, migrant);
+                        continue;
+                }
+                ga_release_individual(parameters, population->individuals[rank->index]);
+                population->individuals[rank->index] = migrant;
+                rank->score = migrant->score;
+                adopted++;
+        }
+        return adopted;
+}
+
+size_t ga_migration_destination(const ga_parameters_t* parameters, const size_t source, const size_t count, rng_t* rng) {
+        if (parameters->migration == GA_MIGRATION_RANDOM) {
+                return (source + 1 + rng_below(rng, count - 1)) % count;
+        }
+        return (source + 1) % count;
+}
+
+// The best individuals of every island replace the worst ones of the next
+// island on the ring, or of another random island. Migrants are shared, not
+// copied.
+void ga_migrate(const ga_parameters_t* parameters, ga_island_t* islands, const size_t epoch) {
+        const size_t count = parameters->island_count;
+        const size_t migrant_count = ga_migrant_count(parameters, islands[0].population->size);
+        if (migrant_count == 0) {
+                return;
+        }
+
+        individual_t** migrants = pool_calloc(count * migrant_count, sizeof(individual_t*));
+        for (size_t i=0 ; i<count ; i++) {
+                population_t* population = islands[i].population;
+                ga_select_emigrants(population, migrant_count);
+                for (size_t m=0 ; m<migrant_count ; m++) {
+                        migrants[i * migrant_count + m] = ga_share_individual(population->individuals[population->ranks[m].index]);
+                }
+        }
+
+        rng_t rng = rng_derive(parameters->seed, -3, epoch);
+        for (size_t i=0 ; i<count ; i++) {
+                const size_t destination = ga_migration_destination(parameters, i, count, &rng);
+                ga_immigrate(parameters, islands[destination].population, migrants + i * migrant_count, migrant_count);
+        }
+        pool_free(migrants, count * migrant_count * sizeof(individual_t*));
+}
+
+// Migrants travel between processes as their score followed by their
+// serialized solution.
+size_t ga_message_capacity(const ga_parameters_t* parameters, const population_t* population) {
+        return sizeof(score_t) + parameters->serialize(parameters->graph, population->individuals[0]->solution, NULL);
+}
+
+void ga_send_migrants(const ga_parameters_t* parameters, population_t* population, const size_t epoch) {
+        transport_t* transport = parameters->transport;
+        const size_t migrant_count = ga_migrant_count(parameters, population->size);
+        if (migrant_count == 0 || transport->count < 2) {
+                return;
+        }
+        rng_t rng = rng_derive(parameters->seed, -3, epoch);
+        const size_t destination = ga_migration_destination(parameters, transport->rank, transport->count, &rng);
+
+        const size_t capacity = ga_message_capacity(parameters, population);
+        unsigned char* message = pool_alloc(capacity);
+        ga_select_emigrants(population, migrant_count);
+        size_t failed = 0;
+        for (size_t m=0 ; m<migrant_count ; m++) {
+                const individual_t* migrant = population->individuals[population->ranks[m].index];
+                memcpy(message, &migrant->score, sizeof(score_t));
+                const size_t size = sizeof(score_t) + parameters->serialize(parameters->graph, migrant->solution, message + sizeof(score_t));
+                failed += transport_send(transport, destination, message, size) != 0;
+        }
+        if (failed > 0 && parameters->verbose) {
+                printf("Island %zu could not send %zu of %zu migrants to island %zu\n", transport->rank, failed, migrant_count, destination);
+        }
+        pool_free(message, capacity);
+}
+
+// Adopts the pending migrants better than the worst individual of the
+// population, the others are dropped without being decoded.
+size_t ga_receive_migrants(const ga_parameters_t* parameters, population_t* population) {
+        const size_t capacity = ga_message_capacity(parameters, population);
+        const size_t max_count = population->size / 2;
+        const score_t worst = ga_population_rank_score(population, population->size - 1);
+        unsigned char* message = pool_alloc(capacity);
+        individual_t** migrants = pool_calloc(max_count, sizeof(individual_t*));
+        size_t count = 0;
+
+        ssize_t size;
+        while (count < max_count && (size = transport_receive(parameters->transport, message, capacity)) >= 0) {
+                score_t score;
+                if ((size_t) size < sizeof(score_t)) {
+                        continue;
+                }
+                memcpy(&score, message, sizeof(score_t));
+                if (score >= worst) {
+                        continue;
+                }
+                GA_SOLUTION_TYPE* solution = parameters->deserialize(parameters->graph, message + sizeof(score_t), size - sizeof(score_t));
+                if (solution == NULL) {
+                        continue;
+                }
+                individual_t* migrant = pool_calloc(1, sizeof(individual_t));
+                migrant->score = -1;
+                migrant->references = 1;
+                migrant->solution = solution;
+                ga_regularize_individual(parameters, migrant);
+                ga_evaluate_individual_score(parameters, migrant);
+                migrants[count++] = migrant;
+        }
+
+        const size_t adopted = ga_immigrate(parameters, population, migrants, count);
+        pool_free(migrants, max_count * sizeof(individual_t*));
+        pool_free(message, capacity);
+        return adopted;
+}
+
+// Islands evolve in parallel, one per thread, and only synchronize to migrate.
+// Each island derives its own seed, so results only depend on the seed and the
+// island count.
+GA_SOLUTION_TYPE* ga_fit_islands(const ga_parameters_t* parameters) {
+        const size_t count = parameters->island_count;
+        ga_island_t* islands = pool_calloc(count, sizeof(ga_island_t));
         individual_t* best_fit = NULL;
-        population_t* population =  ga_generate_random_population(parameters);
+        size_t generation = 0;
 
-        while (!ga_interrupted) {
-                ga_evaluate_population(parameters, population);
+        size_t i;
+        #pragma omp parallel for schedule(static)
+        for (i=0 ; i<count ; i++) {
+                islands[i].parameters = *parameters;
+                islands[i].parameters.seed = rng_mix(parameters->seed ^ rng_mix(i + 1));
+                islands[i].population = ga_generate_random_population(&islands[i].parameters);
+                ga_evaluate_population(&islands[i].parameters, islands[i].population);
+        }
+        for (i=0 ; i<count ; i++) {
+                ga_keep_best_fit(parameters, &best_fit, islands[i].population->individuals[0]);
+        }
+
+        for (size_t epoch=1 ; !ga_finished(parameters, best_fit, generation) ; epoch++) {
+                size_t interval = parameters->migration_interval > 0 ? parameters->migration_interval : 1;
+                if (parameters->max_generations > 0 && generation + interval > parameters->max_generations) {
+                        interval = parameters->max_generations - generation;
+                }
+                #pragma omp parallel for schedule(static)
+                for (i=0 ; i<count ; i++) {
+                        ga_evolve_island(islands + i, generation + 1, interval);
+                }
+                generation += interval;
+
+                ga_migrate(parameters, islands, epoch);
+                for (i=0 ; i<count ; i++) {
+                        ga_evaluate_population(parameters, islands[i].population);
+                        ga_keep_best_fit(parameters, &best_fit, islands[i].population->individuals[0]);
+                }
+                if (parameters->verbose) {
+                        printf("Islands %zu[generation=%zu,best=%f]\n", count, generation, best_fit->score);
+                }
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (i=0 ; i<count ; i++) {
+                ga_destroy_population(&islands[i].parameters, islands[i].population);
+        }
+        pool_free(islands, count * sizeof(ga_island_t));
+        return ga_finish(parameters, best_fit);
+}
 
-                const individual_t* current_best_fit = population->individuals[0];
+// Shared population of the steady state engine. Slots are replaced under
+// their own spin lock, and scores are mirrored in a flat array that threads
+// read without locking. The hashes of the individuals, and of the children
+// being placed, are kept in an open addressing table with linear probing,
+// under its own lock.
+typedef struct {
+        population_t* population;
+        score_t* scores;
+        uint64_t* hashes;
+        char* locks;
+        size_t children;
+        score_t best_score;
+        char best_fit_lock;
+        individual_t* best_fit;
+        uint64_t* table;
+        size_t table_mask;
+        char table_lock;
+} ga_steady_state_t;
+
+void ga_lock(char* lock) {
+        while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+                while (__atomic_load_n(lock, __ATOMIC_RELAXED));
+        }
+}
+
+void ga_unlock(char* lock) {
+        __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+
+score_t ga_steady_state_score(const ga_steady_state_t* state, const size_t slot) {
+        score_t score;
+        __atomic_load(state->scores + slot, &score, __ATOMIC_RELAXED);
+        return score;
+}
+
+// Tournament on the mirrored scores, returns a reference to the winner.
+individual_t* ga_steady_state_select(const ga_parameters_t* parameters, ga_steady_state_t* state, rng_t* rng) {
+        const size_t size = state->population->size;
+        size_t best = rng_below(rng, size);
+        for (size_t i=1 ; i<parameters->tournament_size ; i++) {
+                const size_t challenger = rng_below(rng, size);
+                if (ga_steady_state_score(state, challenger) < ga_steady_state_score(state, best)) {
+                        best = challenger;
+                }
+        }
+        ga_lock(state->locks + best);
+        individual_t* parent = ga_share_individual(state->population->individuals[best]);
+        ga_unlock(state->locks + best);
+        return parent;
+}
+
+void ga_steady_state_keep_best_fit(const ga_parameters_t* parameters, ga_steady_state_t* state, const individual_t* individual) {
+        score_t best_score;
+        __atomic_load(&state->best_score, &best_score, __ATOMIC_RELAXED);
+        if (individual->score >= best_score) {
+                return;
+        }
+        ga_lock(&state->best_fit_lock);
+        if (state->best_fit == NULL || individual->score < state->best_fit->score) {
+                if (state->best_fit != NULL) {
+                        ga_release_individual(parameters, state->best_fit);
+                }
+                state->best_fit = ga_share_individual(individual);
+                __atomic_store(&state->best_score, &individual->score, __ATOMIC_RELAXED);
+        }
+        ga_unlock(&state->best_fit_lock);
+}
+
+// 0 marks the empty cells of the table.
+uint64_t ga_steady_state_key(const uint64_t hash) {
+        return hash != 0 ? hash : 1;
+}
+
+// Adds the key unless it is already there, returns whether it was added.
+int ga_steady_state_reserve(ga_steady_state_t* state, const uint64_t key) {
+        ga_lock(&state->table_lock);
+        size_t i = key & state->table_mask;
+        while (state->table[i] != 0 && state->table[i] != key) {
+                i = (i + 1) & state->table_mask;
+        }
+        const int added = state->table[i] == 0;
+        state->table[i] = key;
+        ga_unlock(&state->table_lock);
+        return added;
+}
+
+// Removes the key if present, moving back the following keys of the probe run so that
+// no tombstone is needed.
+void ga_steady_state_forget(ga_steady_state_t* state, const uint64_t key) {
+        const size_t mask = state->table_mask;
+        ga_lock(&state->table_lock);
+        size_t i = key & mask;
+        while (state->table[i] != key) {
+                // two individuals of the first population may share a hash
+                if (state->table[i] == 0) {
+                        ga_unlock(&state->table_lock);
+                        return;
+                }
+                i = (i + 1) & mask;
+        }
+        for (size_t j=(i + 1) & mask ; state->table[j] != 0 ; j=(j + 1) & mask) {
+                const size_t home = state->table[j] & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                        state->table[i] = state->table[j];
+                        i = j;
+                }
+        }
+        state->table[i] = 0;
+        ga_unlock(&state->table_lock);
+}
+
+// The child replaces the loser of a tournament when it is better and not
+// already in the population. Its hash is reserved first, so that two
+// identical children cannot both get in.
+void ga_steady_state_replace(const ga_parameters_t* parameters, ga_steady_state_t* state, individual_t* child, rng_t* rng) {
+        const size_t size = state->population->size;
+        const uint64_t key = ga_steady_state_key(parameters->hash(parameters->graph, child->solution));
+        if (!ga_steady_state_reserve(state, key)) {
+                ga_release_individual(parameters, child);
+                return;
+        }
 
-                if (best_fit==NULL || current_best_fit->score < best_fit->score) {
-                        if (best_fit!=NULL) {
-                                ga_destroy_individual(parameters, best_fit);
+        size_t loser = rng_below(rng, size);
+        for (size_t i=1 ; i<parameters->tournament_size ; i++) {
+                const size_t challenger = rng_below(rng, size);
+                if (ga_steady_state_score(state, challenger) > ga_steady_state_score(state, loser)) {
+                        loser = challenger;
+                }
+        }
+
+        ga_lock(state->locks + loser);
+        individual_t* replaced = state->population->individuals[loser];
+        if (child->score >= replaced->score) {
+                ga_unlock(state->locks + loser);
+                ga_steady_state_forget(state, key);
+                ga_release_individual(parameters, child);
+                return;
+        }
+        const uint64_t replaced_key = state->hashes[loser];
+        state->population->individuals[loser] = child;
+        __atomic_store(state->scores + loser, &child->score, __ATOMIC_RELAXED);
+        state->hashes[loser] = key;
+        ga_steady_state_keep_best_fit(parameters, state, child);
+        ga_unlock(state->locks + loser);
+        ga_steady_state_forget(state, replaced_key);
+        ga_release_individual(parameters, replaced);
+}
+
+int ga_steady_state_finished(const ga_parameters_t* parameters, ga_steady_state_t* state) {
+        score_t best_score;
+        __atomic_load(&state->best_score, &best_score, __ATOMIC_RELAXED);
+        const size_t children = __atomic_load_n(&state->children, __ATOMIC_RELAXED);
+        return ga_interrupted
+                || (parameters->max_generations > 0 && children >= parameters->max_generations * state->population->size)
+                || best_score <= parameters->target_score;
+}
+
+// Every thread keeps breeding children into the shared population, without
+// waiting for the others. Runs are not reproducible across thread counts.
+GA_SOLUTION_TYPE* ga_fit_steady_state(const ga_parameters_t* parameters) {
+        ga_steady_state_t state;
+        memset(&state, 0, sizeof(state));
+        state.population = ga_generate_random_population(parameters);
+        const size_t size = state.population->size;
+        state.scores = pool_calloc(size, sizeof(score_t));
+        state.hashes = pool_calloc(size, sizeof(uint64_t));
+        state.locks = pool_calloc(size, sizeof(char));
+        // room for the population and the children being placed, a quarter full
+        size_t table_size = 2;
+        while (table_size < 4 * (size + omp_get_max_threads())) {
+                table_size *= 2;
+        }
+        state.table = pool_calloc(table_size, sizeof(uint64_t));
+        state.table_mask = table_size - 1;
+        state.best_score = DBL_MAX;
+        for (size_t i=0 ; i<size ; i++) {
+                const individual_t* individual = state.population->individuals[i];
+                state.scores[i] = individual->score;
+                state.hashes[i] = ga_steady_state_key(parameters->hash(parameters->graph, individual->solution));
+                ga_steady_state_reserve(&state, state.hashes[i]);
+                ga_steady_state_keep_best_fit(parameters, &state, individual);
+        }
+
+        #pragma omp parallel
+        {
+                rng_t rng = rng_derive(parameters->seed, -4, omp_get_thread_num());
+                while (!ga_steady_state_finished(parameters, &state)) {
+                        individual_t* parent1 = ga_steady_state_select(parameters, &state, &rng);
+                        individual_t* parent2 = ga_steady_state_select(parameters, &state, &rng);
+                        individual_t* child = ga_cross_individuals(parameters, parent1, parent2, &rng);
+                        ga_release_individual(parameters, parent1);
+                        ga_release_individual(parameters, parent2);
+                        if (rng_probability(&rng) < parameters->mutation_rate) {
+                                child = ga_mutate(parameters, child, &rng);
+                        }
+                        ga_steady_state_replace(parameters, &state, child, &rng);
+
+                        const size_t children = __atomic_add_fetch(&state.children, 1, __ATOMIC_RELAXED);
+                        if (parameters->verbose && children % size == 0) {
+                                score_t best_score;
+                                __atomic_load(&state.best_score, &best_score, __ATOMIC_RELAXED);
+                                printf("Steady state [children=%zu,best=%f]\n", children, best_score);
                         }
-                        best_fit = ga_copy_individual(parameters, current_best_fit);
                 }
+        }
 
-                ga_print_population(parameters->graph, population);
-                population_t* next_population = ga_generate_next_population(parameters, population);
+        ga_destroy_population(parameters, state.population);
+        pool_free(state.table, (state.table_mask + 1) * sizeof(uint64_t));
+        pool_free(state.locks, size * sizeof(char));
+        pool_free(state.hashes, size * sizeof(uint64_t));
+        pool_free(state.scores, size * sizeof(score_t));
+        return ga_finish(parameters, state.best_fit);
+}
+
+GA_SOLUTION_TYPE* ga_fit(const ga_parameters_t* parameters) {
+        signal(SIGINT, ga_interrupt);
+        ga_parameters_t process_parameters;
+        if (parameters->transport != NULL) {
+                process_parameters = *parameters;
+                process_parameters.seed = rng_mix(parameters->seed ^ rng_mix(parameters->transport->rank + 1));
+                parameters = &process_parameters;
+        } else if (parameters->island_count > 1) {
+                return ga_fit_islands(parameters);
+        } else if (parameters->steady_state) {
+                return ga_fit_steady_state(parameters);
+        }
+
+        individual_t* best_fit = NULL;
+        size_t generation = 0;
+        pool_stats_t stats = pool_get_stats();
+        population_t* population =  ga_generate_random_population(parameters);
+        ga_evaluate_population(parameters, population);
+        ga_keep_best_fit(parameters, &best_fit, population->individuals[0]);
+
+        while (!ga_finished(parameters, best_fit, generation)) {
+                if (parameters->verbose) {
+                        const pool_stats_t current_stats = pool_get_stats();
+                        ga_print_population(parameters->graph, population, current_stats.allocations - stats.allocations);
+                        stats = current_stats;
+                }
+                population_t* next_population = ga_generate_next_population(parameters, population, ++generation);
                 ga_destroy_population(parameters, population);
                 population = next_population;
+                ga_evaluate_population(parameters, population);
+
+                if (parameters->transport != NULL && parameters->migration_interval > 0 && generation % parameters->migration_interval == 0) {
+                        ga_send_migrants(parameters, population, generation / parameters->migration_interval);
+                        ga_receive_migrants(parameters, population);
+                        ga_evaluate_population(parameters, population);
+                }
+                ga_keep_best_fit(parameters, &best_fit, population->individuals[0]);
         }
         ga_destroy_population(parameters, population);
 
-        GA_SOLUTION_TYPE* solution = parameters->copy(parameters->graph, best_fit->solution);
-        ga_destroy_individual(parameters, best_fit);
-
-        return solution;
+        return ga_finish(parameters, best_fit);
 }
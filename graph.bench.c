@@ -0,0 +1,124 @@
+#include <time.h>
+
+#include "graph.c"
+
+rng_t bench_rng;
+
+#define BENCH_2_OPT_CALLS 2000
+
+double bench_now() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void bench_2_opt(const char* label, const graph_t* graph, const path_t* initial) {
+        path_t* path = path_copy(initial);
+        const double start = bench_now();
+        size_t calls = 0;
+        for ( ; calls<BENCH_2_OPT_CALLS ; calls++) {
+                if (!path_2_opt_from_to(graph, path, 0, path->size)) {
+                        break;
+                }
+        }
+        const double elapsed = bench_now() - start;
+        printf("%-10s %zu calls in %.3fs (%.1f calls/s), length %f\n", label, calls, elapsed, calls / elapsed, path_length(graph, path));
+        path_destroy(path);
+}
+
+void bench_local_search(const char* label, const graph_t* graph, const path_t* initial, size_t (*local_search) (const graph_t*, path_t*, size_t, size_t)) {
+        path_t* path = path_copy(initial);
+        const double start = bench_now();
+        size_t moves = 0;
+        while (local_search != NULL) {
+                const size_t current_moves = local_search(graph, path, 0, path->size);
+                if (current_moves == 0) {
+                        break;
+                }
+                moves += current_moves;
+        }
+        const double elapsed = bench_now() - start;
+        printf("%-10s %zu moves in %.3fs, length %f\n", label, moves, elapsed, path_length(graph, path));
+        path_destroy(path);
+}
+
+size_t bench_2_opt_then_or_opt(const graph_t* graph, path_t* path, const size_t from, const size_t count) {
+        return path_2_opt_neighbors(graph, path, from, count) + path_or_opt(graph, path, from, count);
+}
+
+#define BENCH_BUILD_SIZE 200000
+
+void bench_build(const size_t size) {
+        double start = bench_now();
+        graph_t* graph = gra_generate_random_graph(size, &bench_rng);
+        const double build = bench_now() - start;
+
+        path_t* path = path_generate_simple(graph);
+        start = bench_now();
+        const distance_t length = path_length(graph, path);
+        const double evaluation = bench_now() - start;
+
+        printf("%zu nodes graph built in %.3fs, path of length %f evaluated in %.3fs\n", size, build, length, evaluation);
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
+#define BENCH_LOAD_SIZE 2000000
+
+void bench_load(const size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &bench_rng);
+        gra_save("bench_load.csv", graph);
+        gra_save_binary("bench_load.bin", graph);
+
+        double start = bench_now();
+        graph_t* parsed = gra_read("bench_load.csv");
+        const double parse = bench_now() - start;
+
+        start = bench_now();
+        graph_t* mapped = gra_map_binary("bench_load.bin");
+        const double map = bench_now() - start;
+        path_t* path = path_generate_simple(graph);
+        const distance_t length = path_length(mapped, path);
+        const double first_use = bench_now() - start;
+
+        printf("%zu nodes parsed in %.3fs, mapped in %.6fs, %.3fs with a first walk (%s)\n", size, parse, map, first_use,
+                length == path_length(parsed, path) ? "same" : "DIFFERENT");
+        path_destroy(path);
+        gra_destroy_graph(mapped);
+        gra_destroy_graph(parsed);
+        gra_destroy_graph(graph);
+        remove("bench_load.csv");
+        remove("bench_load.bin");
+}
+
+int main(int argc, char** argv) {
+        const size_t size = argc > 1 ? strtoul(argv[1], NULL, 10) : 1024;
+        rng_seed(&bench_rng, 42);
+
+        bench_build(BENCH_BUILD_SIZE);
+        bench_load(BENCH_LOAD_SIZE);
+
+        graph_t* graph = gra_generate_random_graph(size, &bench_rng);
+        path_t* path = path_generate_simple(graph);
+        path_randomize(graph, path, &bench_rng);
+
+        bench_2_opt("on-the-fly", graph, path);
+
+        gra_build_neighbor_lists(graph, GRA_NEIGHBOR_COUNT);
+        bench_local_search("random", graph, path, NULL);
+        bench_local_search("2-opt", graph, path, path_2_opt_neighbors);
+        bench_local_search("or-opt", graph, path, path_or_opt);
+        bench_local_search("2+or-opt", graph, path, bench_2_opt_then_or_opt);
+        bench_local_search("lk-opt", graph, path, path_lk_opt);
+
+        const double start = bench_now();
+        if (!gra_enable_distance_matrix(graph, GRA_MATRIX_MEMORY_LIMIT)) {
+                printf("Not enough memory for a %zu nodes distance matrix\n", size);
+        } else {
+                printf("Matrix of %zu bytes built in %.3fs\n", gra_matrix_memory(size), bench_now() - start);
+                bench_2_opt("matrix", graph, path);
+        }
+
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
@@ -4,56 +4,92 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <assert.h>
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "ensemble.c"
+#include "grid.c"
+#include "random.c"
 
-#define NODE_DATA_TYPE point_t
+#ifndef GRA_MATRIX_TYPE
+#define GRA_MATRIX_TYPE double
+#endif
+
+// uint16_t halves the size of neighborhoods for graphs under 65536 nodes,
+// neighborhood_from_path refuses larger graphs
+#ifndef NEIGHBOR_INDEX_TYPE
+#define NEIGHBOR_INDEX_TYPE element_t
+#endif
+
+#define GRA_ALIGNMENT 64
+#define GRA_MATRIX_BLOCK 32
+#define GRA_MATRIX_MEMORY_LIMIT ((size_t) 256 * 1024 * 1024)
+#define GRA_NEIGHBOR_COUNT 10
+#define PATH_2_OPT_EPSILON 1e-9
 
 typedef double distance_t;
 
+typedef GRA_MATRIX_TYPE matrix_distance_t;
+
 typedef struct {
         distance_t x;
         distance_t y;
 } point_t;
 
-typedef struct {
-        NODE_DATA_TYPE* metadata;
-} node_t;
-
-typedef struct {
+// TSPLIB edge weight types. GRA_EUCLIDEAN is the unrounded distance used by
+// generated instances, GRA_EXPLICIT graphs only have a distance matrix.
+typedef enum {
+        GRA_EUCLIDEAN,
+        GRA_EUC_2D,
+        GRA_CEIL_2D,
+        GRA_GEO,
+        GRA_ATT,
+        GRA_EXPLICIT
+} gra_metric_t;
+
+typedef struct graph {
         size_t size;
-        node_t* nodes;
+        distance_t* xs;
+        distance_t* ys;
+        gra_metric_t metric;
+        // chosen once per instance, so distance lookups never test the metric
+        distance_t (*distance)(const struct graph*, const element_t, const element_t);
+        size_t matrix_blocks;
+        matrix_distance_t* matrix;
+        size_t neighbor_count;
+        element_t* neighbor_lists;
+        // file mapped by gra_map_binary, holding the coordinates
+        void* mapping;
+        size_t mapping_size;
 } graph_t;
 
-typedef struct {
-        distance_t distance;
-        element_t node;
-} neighbor_t;
+typedef NEIGHBOR_INDEX_TYPE neighbor_index_t;
 
+// The two tour neighbors of every node, at 2 * node and 2 * node + 1, without
+// their distances which are looked up in the graph when needed.
 typedef struct {
         size_t node_count;
         distance_t length;
-        neighbor_t* neighbors;
+        neighbor_index_t* links;
 } neighborhood_t;
 
 typedef struct {
         size_t size;
         element_t* node_indices;
+        element_t* positions;
         neighborhood_t* neighborhood;
 } path_t;
 
-NODE_DATA_TYPE* gra_create_empty_metadata() {
-        return calloc(1, sizeof(NODE_DATA_TYPE));
-}
+int path_positions_enabled = 1;
 
-point_t* point_of(const distance_t x, const distance_t y) {
-        point_t* point = calloc(1, sizeof(point_t));
-        point->x = x;
-        point->y = y;
+point_t point_of(const distance_t x, const distance_t y) {
+        point_t point = { x, y };
         return point;
 }
 
@@ -61,70 +97,295 @@ void point_print(const point_t* point) {
         printf("Point %p[x=%f,y=%f]\n", point, point->x, point->y);
 }
 
-point_t* point_generate_random() {
-        return point_of(rand() % 5000, rand() % 5000);
+point_t point_generate_random(rng_t* rng) {
+        return point_of(rng_below(rng, 5000), rng_below(rng, 5000));
+}
+
+size_t gra_align(const size_t size) {
+        return (size + GRA_ALIGNMENT - 1) / GRA_ALIGNMENT * GRA_ALIGNMENT;
+}
+
+size_t gra_coordinates_stride(const size_t size) {
+        return gra_align(size * sizeof(distance_t)) / sizeof(distance_t);
+}
+
+distance_t gra_compute_distance(const graph_t* graph, const element_t node1, const element_t node2) {
+        const distance_t dx = graph->xs[node1] - graph->xs[node2];
+        const distance_t dy = graph->ys[node1] - graph->ys[node2];
+        return sqrt(dx*dx + dy*dy);
+}
+
+distance_t gra_euc_2d_distance(const graph_t* graph, const element_t node1, const element_t node2) {
+        return (long) (gra_compute_distance(graph, node1, node2) + 0.5);
+}
+
+distance_t gra_ceil_2d_distance(const graph_t* graph, const element_t node1, const element_t node2) {
+        return ceil(gra_compute_distance(graph, node1, node2));
+}
+
+distance_t gra_att_distance(const graph_t* graph, const element_t node1, const element_t node2) {
+        const distance_t dx = graph->xs[node1] - graph->xs[node2];
+        const distance_t dy = graph->ys[node1] - graph->ys[node2];
+        const distance_t r = sqrt((dx*dx + dy*dy) / 10);
+        const distance_t t = (long) (r + 0.5);
+        return t < r ? t + 1 : t;
 }
 
-void point_destroy(point_t* point) {
-        free(point);
+// TSPLIB coordinates in DDD.MM degrees and minutes, as radians.
+distance_t gra_geo_radians(const distance_t coordinate) {
+        const long degrees = coordinate;
+        return 3.141592 * (degrees + 5.0 * (coordinate - degrees) / 3.0) / 180.0;
 }
 
-void gra_destroy_metadata(NODE_DATA_TYPE* metadata) {
-        free(metadata);
+distance_t gra_geo_distance(const graph_t* graph, const element_t node1, const element_t node2) {
+        const distance_t latitude1 = gra_geo_radians(graph->xs[node1]);
+        const distance_t longitude1 = gra_geo_radians(graph->ys[node1]);
+        const distance_t latitude2 = gra_geo_radians(graph->xs[node2]);
+        const distance_t longitude2 = gra_geo_radians(graph->ys[node2]);
+        const distance_t q1 = cos(longitude1 - longitude2);
+        const distance_t q2 = cos(latitude1 - latitude2);
+        const distance_t q3 = cos(latitude1 + latitude2);
+        return (long) (6378.388 * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
 }
 
+void gra_distances_from_node(const graph_t* graph, const element_t node, const element_t from, const element_t to, distance_t* restrict distances) {
+        const distance_t* restrict xs = graph->xs;
+        const distance_t* restrict ys = graph->ys;
+        const distance_t x = xs[node];
+        const distance_t y = ys[node];
+        for (element_t i=from ; i<to ; i++) {
+                const distance_t dx = x - xs[i];
+                const distance_t dy = y - ys[i];
+                distances[i - from] = sqrt(dx*dx + dy*dy);
+        }
+}
+
+// The matrix is stored as GRA_MATRIX_BLOCK x GRA_MATRIX_BLOCK tiles so that
+// lookups around the same few nodes stay within a handful of cache lines.
+size_t gra_matrix_index(const graph_t* graph, const element_t node1, const element_t node2) {
+        const size_t block = (node1 / GRA_MATRIX_BLOCK) * graph->matrix_blocks + node2 / GRA_MATRIX_BLOCK;
+        return (block * GRA_MATRIX_BLOCK + node1 % GRA_MATRIX_BLOCK) * GRA_MATRIX_BLOCK + node2 % GRA_MATRIX_BLOCK;
+}
+
+distance_t gra_matrix_distance(const graph_t* graph, const element_t node1, const element_t node2) {
+        return graph->matrix[gra_matrix_index(graph, node1, node2)];
+}
+
+void gra_set_metric(graph_t* graph, const gra_metric_t metric) {
+        graph->metric = metric;
+        switch (metric) {
+                case GRA_EUC_2D:
+                        graph->distance = gra_euc_2d_distance;
+                        break;
+                case GRA_CEIL_2D:
+                        graph->distance = gra_ceil_2d_distance;
+                        break;
+                case GRA_GEO:
+                        graph->distance = gra_geo_distance;
+                        break;
+                case GRA_ATT:
+                        graph->distance = gra_att_distance;
+                        break;
+                case GRA_EXPLICIT:
+                        graph->distance = gra_matrix_distance;
+                        break;
+                default:
+                        graph->distance = gra_compute_distance;
+        }
+        if (graph->matrix != NULL) {
+                graph->distance = gra_matrix_distance;
+        }
+}
+
+// The graph header and both coordinate arrays share one aligned allocation.
 graph_t* gra_create(const size_t size) {
-        graph_t* graph = calloc(1, sizeof(graph_t));
+        const size_t header = gra_align(sizeof(graph_t));
+        const size_t stride = gra_coordinates_stride(size);
+        const size_t memory = header + 2 * stride * sizeof(distance_t);
+        char* block = aligned_alloc(GRA_ALIGNMENT, memory);
+        memset(block, 0, memory);
+
+        graph_t* graph = (graph_t*) block;
         graph->size = size;
-        graph->nodes = calloc(size, sizeof(NODE_DATA_TYPE*));
+        graph->xs = (distance_t*) (block + header);
+        graph->ys = graph->xs + stride;
+        gra_set_metric(graph, GRA_EUCLIDEAN);
         return graph;
 }
 
+point_t gra_point(const graph_t* graph, const element_t node) {
+        return point_of(graph->xs[node], graph->ys[node]);
+}
+
+void gra_set_point(graph_t* graph, const element_t node, const point_t point) {
+        graph->xs[node] = point.x;
+        graph->ys[node] = point.y;
+}
+
 graph_t* gra_of(const size_t node_count, ...) {
         va_list valist;
         graph_t* graph = gra_create(node_count);
 
         va_start(valist, node_count);
         for (size_t i = 0; i<node_count; i++) {
-                NODE_DATA_TYPE* current_node = va_arg(valist, NODE_DATA_TYPE*);
-                graph->nodes[i].metadata = current_node;
+                gra_set_point(graph, i, va_arg(valist, point_t));
         }
         va_end(valist);
 
         return graph;
 }
 
-graph_t* gra_generate_random_graph(const size_t size) {
-        graph_t* graph = calloc(1, sizeof(graph_t));
-        graph->size = size;
-        graph->nodes = calloc(size, sizeof(NODE_DATA_TYPE*));
+graph_t* gra_generate_random_graph(const size_t size, rng_t* rng) {
+        graph_t* graph = gra_create(size);
         for (size_t i=0 ; i<size ; i++) {
-                graph->nodes[i].metadata = point_generate_random();
+                gra_set_point(graph, i, point_generate_random(rng));
         }
         return graph;
 }
 
+size_t gra_matrix_memory(const size_t size) {
+        const size_t blocks = (size + GRA_MATRIX_BLOCK - 1) / GRA_MATRIX_BLOCK;
+        return blocks * blocks * GRA_MATRIX_BLOCK * GRA_MATRIX_BLOCK * sizeof(matrix_distance_t);
+}
+
+// The matrix of an explicit graph is its only distance, it is kept.
+void gra_disable_distance_matrix(graph_t* graph) {
+        if (graph->metric == GRA_EXPLICIT) {
+                return;
+        }
+        free(graph->matrix);
+        graph->matrix = NULL;
+        graph->matrix_blocks = 0;
+        gra_set_metric(graph, graph->metric);
+}
+
+matrix_distance_t* gra_allocate_distance_matrix(graph_t* graph) {
+        const size_t memory = gra_matrix_memory(graph->size);
+        matrix_distance_t* matrix = aligned_alloc(64, memory);
+        if (matrix == NULL) {
+                return NULL;
+        }
+        memset(matrix, 0, memory);
+        graph->matrix_blocks = (graph->size + GRA_MATRIX_BLOCK - 1) / GRA_MATRIX_BLOCK;
+        return matrix;
+}
+
+int gra_enable_distance_matrix(graph_t* graph, const size_t memory_limit) {
+        const size_t memory = gra_matrix_memory(graph->size);
+        if (memory == 0 || memory > memory_limit || graph->metric == GRA_EXPLICIT) {
+                return 0;
+        }
+        // a matrix already in place is kept until the new one is ready
+        matrix_distance_t* matrix = gra_allocate_distance_matrix(graph);
+        distance_t* row = calloc(graph->size, sizeof(distance_t));
+        if (matrix == NULL || row == NULL) {
+                free(matrix);
+                free(row);
+                return 0;
+        }
+
+        for (element_t i=0 ; i<graph->size ; i++) {
+                if (graph->metric == GRA_EUCLIDEAN) {
+                        gra_distances_from_node(graph, i, 0, i, row);
+                } else {
+                        for (element_t j=0 ; j<i ; j++) {
+                                row[j] = graph->distance(graph, i, j);
+                        }
+                }
+                for (element_t j=0 ; j<i ; j++) {
+                        matrix[gra_matrix_index(graph, i, j)] = row[j];
+                        matrix[gra_matrix_index(graph, j, i)] = row[j];
+                }
+        }
+        free(row);
+        free(graph->matrix);
+        graph->matrix = matrix;
+        gra_set_metric(graph, graph->metric);
+        return 1;
+}
+
+void gra_destroy_neighbor_lists(graph_t* graph) {
+        free(graph->neighbor_lists);
+        graph->neighbor_lists = NULL;
+        graph->neighbor_count = 0;
+}
+
+void gra_build_neighbor_lists(graph_t* graph, size_t count) {
+        gra_destroy_neighbor_lists(graph);
+        if (count >= graph->size) {
+                count = graph->size - 1;
+        }
+        if (count == 0) {
+                return;
+        }
+
+        element_t* neighbor_lists = calloc(graph->size * count, sizeof(element_t));
+        distance_t* distances = calloc(count, sizeof(distance_t));
+        if (graph->metric == GRA_GEO || graph->metric == GRA_EXPLICIT) {
+                // the grid only orders nodes by euclidean distance
+                for (element_t i=0 ; i<graph->size ; i++) {
+                        size_t found = 0;
+                        for (element_t j=0 ; j<graph->size ; j++) {
+                                if (j != i) {
+                                        found = grid_insert_candidate(count, found, neighbor_lists + i * count, distances, j, graph->distance(graph, i, j));
+                                }
+                        }
+                }
+        } else {
+                grid_t* grid = grid_create(graph->xs, graph->ys, graph->size);
+                for (element_t i=0 ; i<graph->size ; i++) {
+                        grid_nearest(grid, graph->xs[i], graph->ys[i], count, i, neighbor_lists + i * count, distances);
+                }
+                grid_destroy(grid);
+        }
+        free(distances);
+
+        graph->neighbor_lists = neighbor_lists;
+        graph->neighbor_count = count;
+}
+
+const element_t* gra_neighbors(const graph_t* graph, const element_t node) {
+        return graph->neighbor_lists + node * graph->neighbor_count;
+}
+
 void gra_destroy_graph(graph_t* graph) {
-        for (size_t i=0 ; i<graph->size ; i++) {
-                gra_destroy_metadata(graph->nodes[i].metadata);
+        free(graph->matrix);
+        gra_destroy_neighbor_lists(graph);
+        if (graph->mapping != NULL) {
+                munmap(graph->mapping, graph->mapping_size);
         }
-        free(graph->nodes);
         free(graph);
 }
 
 distance_t gra_distance_between_nodes(const graph_t* graph, const element_t node1, const element_t node2) {
-        const distance_t dx = graph->nodes[node1].metadata->x - graph->nodes[node2].metadata->x;
-        const distance_t dy = graph->nodes[node1].metadata->y - graph->nodes[node2].metadata->y;
-        return sqrt(dx*dx + dy*dy);
+        return graph->distance(graph, node1, node2);
 }
 
 path_t* path_generate_empty(const size_t size) {
-        path_t* path = calloc(1, sizeof(path_t));
+        path_t* path = pool_calloc(1, sizeof(path_t));
         path->size = size;
-        path->node_indices = calloc(size, sizeof(element_t));
+        path->node_indices = pool_calloc(size, sizeof(element_t));
         return path;
 }
 
+void path_set_positions_enabled(const int enabled) {
+        path_positions_enabled = enabled;
+}
+
+// Builds the node to position index once node_indices holds a permutation of
+// the graph nodes. It is then kept up to date by the path operations.
+void path_index_positions(path_t* path) {
+        if (!path_positions_enabled) {
+                return;
+        }
+        if (path->positions == NULL) {
+                path->positions = pool_calloc(path->size, sizeof(element_t));
+        }
+        for (size_t i=0 ; i<path->size ; i++) {
+                path->positions[path->node_indices[i]] = i;
+        }
+}
+
 void path_print(const graph_t* graph, path_t* const path) {
         printf("Path %p[size=%zu,nodes=", path, path->size);
         for (size_t i=0 ; i<path->size ; i++) {
@@ -155,23 +416,20 @@ element_t path_previous(const path_t* path, const size_t index) {
 }
 
 neighborhood_t* neighborhood_from_path(const graph_t* graph, const path_t* path) {
-        neighborhood_t* neighborhood = calloc(1, sizeof(neighborhood_t));
+        if (path->size > 0 && path->size - 1 > (neighbor_index_t) -1) {
+                printf("Error: %zu nodes do not fit in NEIGHBOR_INDEX_TYPE, build with a wider type\n", path->size);
+                exit(1);
+        }
+        neighborhood_t* neighborhood = pool_calloc(1, sizeof(neighborhood_t));
         neighborhood->node_count = path->size;
-        neighborhood->neighbors = calloc(path->size * 2, sizeof(neighbor_t));
+        neighborhood->links = pool_calloc(path->size * 2, sizeof(neighbor_index_t));
 
         element_t previous = path_previous(path, 0);
         for (size_t i = 0 ; i<path->size ; i++) {
                 element_t current = path_node_at(path, i);
-                distance_t distance = gra_distance_between_nodes(graph, previous, current);
-
-                neighborhood->neighbors[2 * current + 1].distance = distance;
-                neighborhood->neighbors[2 * current + 1].node = previous;
-
-                neighborhood->neighbors[2 * previous].distance = distance;
-                neighborhood->neighbors[2 * previous].node = current;
-
-                neighborhood->length += distance;
-
+                neighborhood->links[2 * current + 1] = previous;
+                neighborhood->links[2 * previous] = current;
+                neighborhood->length += gra_distance_between_nodes(graph, previous, current);
                 previous = current;
         }
 
@@ -179,27 +437,49 @@ neighborhood_t* neighborhood_from_path(const graph_t* graph, const path_t* path)
 }
 
 neighborhood_t* neighborhood_copy(const neighborhood_t* neighborhood) {
-        neighborhood_t* copy = calloc(1, sizeof(neighborhood_t));
+        neighborhood_t* copy = pool_calloc(1, sizeof(neighborhood_t));
         copy->node_count = neighborhood->node_count;
-        copy->neighbors = calloc(neighborhood->node_count * 2, sizeof(neighborhood_t));
-        memcpy(copy->neighbors, neighborhood->neighbors, neighborhood->node_count * 2 * sizeof(element_t));
+        copy->length = neighborhood->length;
+        copy->links = pool_calloc(neighborhood->node_count * 2, sizeof(neighbor_index_t));
+        memcpy(copy->links, neighborhood->links, neighborhood->node_count * 2 * sizeof(neighbor_index_t));
         return copy;
 }
 
-const neighbor_t* neighborhood_neighbors(const neighborhood_t* neighborhood, element_t node, size_t index) {
-        return neighborhood->neighbors + (2 * node + index);
+element_t neighborhood_neighbor(const neighborhood_t* neighborhood, const element_t node, const size_t index) {
+        return neighborhood->links[2 * node + index];
+}
+
+// Incremental updates keep, for each node, its two tour neighbors but not
+// which one is next and which one is previous.
+void neighborhood_relink(neighborhood_t* neighborhood, const element_t node, const element_t old_neighbor, const element_t new_neighbor) {
+        neighbor_index_t* link = neighborhood->links + 2 * node;
+        link[*link == old_neighbor ? 0 : 1] = new_neighbor;
+}
+
+// Replaces the tour edges (x, y) and (u, v) by (x, u) and (y, v) in O(1).
+void neighborhood_move_2_opt(const graph_t* graph, neighborhood_t* neighborhood, const element_t x, const element_t y, const element_t u, const element_t v) {
+        neighborhood->length += gra_distance_between_nodes(graph, x, u) + gra_distance_between_nodes(graph, y, v)
+                - gra_distance_between_nodes(graph, x, y) - gra_distance_between_nodes(graph, u, v);
+        neighborhood_relink(neighborhood, x, y, u);
+        neighborhood_relink(neighborhood, y, x, v);
+        neighborhood_relink(neighborhood, u, v, x);
+        neighborhood_relink(neighborhood, v, u, y);
 }
 
 void neighborhood_destroy(neighborhood_t* neighborhood) {
-        free(neighborhood->neighbors);
-        free(neighborhood);
+        pool_free(neighborhood->links, neighborhood->node_count * 2 * sizeof(neighbor_index_t));
+        pool_free(neighborhood, sizeof(neighborhood_t));
 }
 
 path_t* path_copy(const path_t* path) {
-        path_t* copy = calloc(1, sizeof(path_t));
+        path_t* copy = pool_calloc(1, sizeof(path_t));
         copy->size = path->size;
-        copy->node_indices = calloc(copy->size, sizeof(element_t));
+        copy->node_indices = pool_calloc(copy->size, sizeof(element_t));
         memcpy(copy->node_indices, path->node_indices, path->size * sizeof(element_t));
+        if (path->positions != NULL) {
+                copy->positions = pool_calloc(copy->size, sizeof(element_t));
+                memcpy(copy->positions, path->positions, path->size * sizeof(element_t));
+        }
         if (path->neighborhood != NULL) {
                 copy->neighborhood = neighborhood_copy(path->neighborhood);
         }
@@ -207,9 +487,9 @@ path_t* path_copy(const path_t* path) {
 }
 
 path_t* path_extract_path_with_nodes_not_in_ensemble(const path_t* path, const ensemble_t* ensemble, const size_t from, const size_t count) {
-        path_t* copy = calloc(1, sizeof(path_t));
+        path_t* copy = pool_calloc(1, sizeof(path_t));
         copy->size = 0;
-        copy->node_indices = calloc(count, sizeof(element_t));
+        copy->node_indices = pool_calloc(count, sizeof(element_t));
         for (size_t i=0 ; i<path->size && copy->size < count ; i++) {
                 const element_t current = *(path->node_indices + (i + from) % path->size);
                 if (!ens_contains(ensemble, current)) {
@@ -221,9 +501,9 @@ path_t* path_extract_path_with_nodes_not_in_ensemble(const path_t* path, const e
 }
 
 path_t* path_of(const size_t node_count, ...) {
-        path_t* path = calloc(1, sizeof(path_t));
+        path_t* path = pool_calloc(1, sizeof(path_t));
         path->size = node_count;
-        path->node_indices = calloc(node_count, sizeof(element_t));
+        path->node_indices = pool_calloc(node_count, sizeof(element_t));
         va_list valist;
         va_start(valist, node_count);
         for (size_t i = 0; i<node_count; i++) {
@@ -244,9 +524,9 @@ path_t* path_concat(const size_t path_count, ...) {
         }
         va_end(valist);
 
-        path_t* copy = calloc(1, sizeof(path_t));
+        path_t* copy = pool_calloc(1, sizeof(path_t));
         copy->size = length;
-        copy->node_indices = calloc(length, sizeof(element_t));
+        copy->node_indices = pool_calloc(length, sizeof(element_t));
 
         va_start(valist, path_count);
         size_t current_index = 0;
@@ -265,6 +545,7 @@ path_t* path_generate_simple(const graph_t* graph) {
         for (element_t i=0 ; i<path->size ; i++) {
                 path->node_indices[i] = i;
         }
+        path_index_positions(path);
 
         return path;
 }
@@ -273,17 +554,50 @@ void path_swap_nodes(path_t* path, const size_t index1, const size_t index2) {
         const element_t t = path->node_indices[index1];
         path->node_indices[index1] = path->node_indices[index2];
         path->node_indices[index2] = t;
+        if (path->positions != NULL) {
+                path->positions[path->node_indices[index1]] = index1;
+                path->positions[t] = index2;
+        }
 }
 
-void path_shift(path_t* path, const size_t shift) {
-        element_t* buffer = calloc(path->size, sizeof(element_t));
-        memcpy(buffer, path->node_indices, path->size * sizeof(element_t));
-        memcpy(path->node_indices, buffer + shift, (path->size - shift) * sizeof(element_t));
-        memcpy(path->node_indices + path->size - shift, buffer, shift * sizeof(element_t));
-        free(buffer);
+// Swaps two nodes of the tour, updating its neighborhood when there is one.
+void path_exchange_nodes(const graph_t* graph, path_t* path, const size_t index1, const size_t index2) {
+        neighborhood_t* neighborhood = path->neighborhood;
+        if (neighborhood == NULL || index1 == index2 || path->size <= 3) {
+                path_swap_nodes(path, index1, index2);
+                return;
+        }
+        const element_t a = path->node_indices[index1];
+        const element_t b = path->node_indices[index2];
+        const element_t a_neighbors[2] = { neighborhood_neighbor(neighborhood, a, 0), neighborhood_neighbor(neighborhood, a, 1) };
+        const element_t b_neighbors[2] = { neighborhood_neighbor(neighborhood, b, 0), neighborhood_neighbor(neighborhood, b, 1) };
+        path_swap_nodes(path, index1, index2);
+
+        if (a_neighbors[0] == b || a_neighbors[1] == b) {
+                // swapping adjacent nodes reverses the edge between them
+                const element_t p = a_neighbors[0] == b ? a_neighbors[1] : a_neighbors[0];
+                const element_t n = b_neighbors[0] == a ? b_neighbors[1] : b_neighbors[0];
+                neighborhood_move_2_opt(graph, neighborhood, p, a, b, n);
+                return;
+        }
+        for (size_t i=0 ; i<2 ; i++) {
+                neighborhood->length += gra_distance_between_nodes(graph, b, a_neighbors[i]) + gra_distance_between_nodes(graph, a, b_neighbors[i])
+                        - gra_distance_between_nodes(graph, a, a_neighbors[i]) - gra_distance_between_nodes(graph, b, b_neighbors[i]);
+                neighborhood_relink(neighborhood, a_neighbors[i], a, b);
+        }
+        for (size_t i=0 ; i<2 ; i++) {
+                neighborhood_relink(neighborhood, b_neighbors[i], b, a);
+        }
+        for (size_t i=0 ; i<2 ; i++) {
+                neighborhood->links[2 * a + i] = b_neighbors[i];
+                neighborhood->links[2 * b + i] = a_neighbors[i];
+        }
 }
 
 size_t path_node_position(const path_t* path, const element_t node) {
+        if (path->positions != NULL) {
+                return path->positions[node];
+        }
         for (size_t i=0 ; i<path->size ; i++) {
                 if (*(path->node_indices + i) == node) {
                         return i;
@@ -292,16 +606,9 @@ size_t path_node_position(const path_t* path, const element_t node) {
         return -1;
 }
 
-void path_set_starting_node(path_t* path, const element_t start_node) {
-        const size_t first_element_index = path_node_position(path, start_node);
-        if (first_element_index > 0) {
-                path_shift(path, first_element_index);
-        }
-}
-
-void path_randomize(const graph_t* graph, path_t* path) {
+void path_randomize(const graph_t* graph, path_t* path, rng_t* rng) {
         for (size_t i=0 ; i<path->size - 1 ; i++) {
-                size_t j = i + rand() / (RAND_MAX / (path->size - i) + 1);
+                size_t j = i + rng_below(rng, path->size - i);
                 path_swap_nodes(path, i, j);
         }
 }
@@ -332,6 +639,66 @@ void path_revert(path_t* path) {
         path_revert_from(path, 0);
 }
 
+size_t path_gcd(size_t a, size_t b) {
+        while (b != 0) {
+                const size_t r = a % b;
+                a = b;
+                b = r;
+        }
+        return a;
+}
+
+// Normalizes the path in place so that it starts at index shift, walking
+// backward from it when reversed is set. The forward rotation follows the
+// gcd(size, shift) cycles of the permutation and the reversed one swaps
+// mirrored pairs, so each node is moved once and nothing is allocated.
+void path_rotate(path_t* path, const size_t shift, const int reversed) {
+        const size_t size = path->size;
+        if (reversed) {
+                path_revert_from_to(path, 0, shift + 1);
+                path_revert_from_to(path, shift + 1, size);
+                return;
+        }
+        if (shift == 0) {
+                return;
+        }
+        element_t* nodes = path->node_indices;
+        const size_t cycles = path_gcd(size, shift);
+        for (size_t start=0 ; start<cycles ; start++) {
+                const element_t first = nodes[start];
+                size_t current = start;
+                while (1) {
+                        size_t next = current + shift;
+                        if (next >= size) {
+                                next -= size;
+                        }
+                        if (next == start) {
+                                break;
+                        }
+                        nodes[current] = nodes[next];
+                        if (path->positions != NULL) {
+                                path->positions[nodes[current]] = current;
+                        }
+                        current = next;
+                }
+                nodes[current] = first;
+                if (path->positions != NULL) {
+                        path->positions[first] = current;
+                }
+        }
+}
+
+void path_shift(path_t* path, const size_t shift) {
+        path_rotate(path, shift, 0);
+}
+
+void path_set_starting_node(path_t* path, const element_t start_node) {
+        const size_t first_element_index = path_node_position(path, start_node);
+        if (first_element_index > 0) {
+                path_shift(path, first_element_index);
+        }
+}
+
 int path_cmp(const path_t* path1, const path_t* path2) {
         if (path1->size != path2->size) {
                 return path1->size - path2->size ? -1 : 1;
@@ -339,6 +706,18 @@ int path_cmp(const path_t* path1, const path_t* path2) {
         return memcmp(path1->node_indices, path2->node_indices, path1->size * sizeof(element_t));
 }
 
+// Hash of the set of edges of the tour, independent of its starting node and
+// direction.
+uint64_t path_hash(const path_t* path) {
+        uint64_t hash = 0;
+        for (size_t i=0 ; i<path->size ; i++) {
+                const uint64_t a = path->node_indices[i];
+                const uint64_t b = path->node_indices[(i + 1) % path->size];
+                hash += rng_mix(a < b ? a << 32 | b : b << 32 | a);
+        }
+        return hash;
+}
+
 element_t path_first_node_not_in_ensemble(const path_t* path, const ensemble_t* ensemble) {
         for (size_t i=0; i < path->size ; i++) {
                 element_t current = *(path->node_indices + i);
@@ -374,13 +753,20 @@ void path_destroy(path_t* path) {
         if (path->neighborhood != NULL) {
                 neighborhood_destroy(path->neighborhood);
         }
-        free(path->node_indices);
-        free(path);
+        pool_free(path->positions, path->size * sizeof(element_t));
+        pool_free(path->node_indices, path->size * sizeof(element_t));
+        pool_free(path, sizeof(path_t));
 }
 
-int path_2_opt_iteration(const graph_t* graph, path_t* path, const size_t starting_node, const size_t from, const size_t to) {
-        distance_t improvement = 0;
-        element_t improvement_node = 0;
+typedef struct {
+        distance_t gain;
+        size_t index;
+} two_opt_move_t;
+
+typedef two_opt_move_t (*two_opt_kernel_t)(const distance_t*, const distance_t*, const element_t*, element_t, element_t, distance_t, size_t, size_t, two_opt_move_t);
+
+two_opt_move_t path_2_opt_best_move_reference(const graph_t* graph, const path_t* path, const size_t starting_node, const size_t from, const size_t to) {
+        two_opt_move_t move = { 0, 0 };
         for (size_t j=from ; j<to ; j++) {
                 if (j + 1 < starting_node || j > starting_node + 1) {
                         const element_t xi = path_node_at(path, starting_node);
@@ -392,14 +778,221 @@ int path_2_opt_iteration(const graph_t* graph, path_t* path, const size_t starti
                                 + gra_distance_between_nodes(graph, xj, xj1)
                                 - gra_distance_between_nodes(graph, xi, xj)
                                 - gra_distance_between_nodes(graph, xi1, xj1);
-                        if (current_improvement > improvement) {
-                                improvement = current_improvement;
-                                improvement_node = j;
+                        if (current_improvement > move.gain) {
+                                move.gain = current_improvement;
+                                move.index = j;
                         }
                 }
         }
-        if (improvement > 0) {
-                path_revert_from_to(path, starting_node + 1, improvement_node + 1);
+        return move;
+}
+
+distance_t gra_coordinates_distance(const distance_t* xs, const distance_t* ys, const element_t node1, const element_t node2) {
+        const distance_t dx = xs[node1] - xs[node2];
+        const distance_t dy = ys[node1] - ys[node2];
+        return sqrt(dx*dx + dy*dy);
+}
+
+// Kernels scan j in [from, to) and expect nodes[j + 1] to exist, the wrap
+// around the end of the path is left to path_2_opt_best_move_with.
+two_opt_move_t path_2_opt_kernel_scalar(const distance_t* xs, const distance_t* ys, const element_t* nodes, const element_t xi, const element_t xi1, const distance_t base, const size_t from, const size_t to, two_opt_move_t move) {
+        for (size_t j=from ; j<to ; j++) {
+                const element_t xj = nodes[j];
+                const element_t xj1 = nodes[j + 1];
+                const distance_t current_improvement =
+                        base
+                        + gra_coordinates_distance(xs, ys, xj, xj1)
+                        - gra_coordinates_distance(xs, ys, xi, xj)
+                        - gra_coordinates_distance(xs, ys, xi1, xj1);
+                if (current_improvement > move.gain) {
+                        move.gain = current_improvement;
+                        move.index = j;
+                }
+        }
+        return move;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+#define PATH_2_OPT_SIMD 1
+
+two_opt_move_t path_2_opt_reduce_lanes(const distance_t* gains, const distance_t* indices, const size_t lanes, two_opt_move_t move) {
+        size_t best_lane = lanes;
+        for (size_t lane=0 ; lane<lanes ; lane++) {
+                if (indices[lane] < 0) {
+                        continue;
+                }
+                if (best_lane == lanes || gains[lane] > gains[best_lane] || (gains[lane] == gains[best_lane] && indices[lane] < indices[best_lane])) {
+                        best_lane = lane;
+                }
+        }
+        if (best_lane != lanes && gains[best_lane] > move.gain) {
+                move.gain = gains[best_lane];
+                move.index = indices[best_lane];
+        }
+        return move;
+}
+
+__m128d path_2_opt_distance_sse2(const __m128d x1, const __m128d y1, const __m128d x2, const __m128d y2) {
+        const __m128d dx = _mm_sub_pd(x1, x2);
+        const __m128d dy = _mm_sub_pd(y1, y2);
+        return _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+}
+
+two_opt_move_t path_2_opt_kernel_sse2(const distance_t* xs, const distance_t* ys, const element_t* nodes, const element_t xi, const element_t xi1, const distance_t base, const size_t from, const size_t to, two_opt_move_t move) {
+        const __m128d xi_x = _mm_set1_pd(xs[xi]);
+        const __m128d xi_y = _mm_set1_pd(ys[xi]);
+        const __m128d xi1_x = _mm_set1_pd(xs[xi1]);
+        const __m128d xi1_y = _mm_set1_pd(ys[xi1]);
+        const __m128d base_gain = _mm_set1_pd(base);
+        const __m128d step = _mm_set1_pd(2);
+        __m128d best_gain = _mm_set1_pd(move.gain);
+        __m128d best_index = _mm_set1_pd(-1);
+        __m128d index = _mm_set_pd(from + 1, from);
+
+        size_t j = from;
+        for (; j + 2 <= to ; j += 2) {
+                const element_t xj0 = nodes[j];
+                const element_t xj1 = nodes[j + 1];
+                const element_t xj2 = nodes[j + 2];
+                const __m128d xj_x = _mm_set_pd(xs[xj1], xs[xj0]);
+                const __m128d xj_y = _mm_set_pd(ys[xj1], ys[xj0]);
+                const __m128d xj1_x = _mm_set_pd(xs[xj2], xs[xj1]);
+                const __m128d xj1_y = _mm_set_pd(ys[xj2], ys[xj1]);
+                const __m128d gain = _mm_sub_pd(_mm_sub_pd(
+                        _mm_add_pd(base_gain, path_2_opt_distance_sse2(xj_x, xj_y, xj1_x, xj1_y)),
+                        path_2_opt_distance_sse2(xi_x, xi_y, xj_x, xj_y)),
+                        path_2_opt_distance_sse2(xi1_x, xi1_y, xj1_x, xj1_y));
+                const __m128d better = _mm_cmpgt_pd(gain, best_gain);
+                best_gain = _mm_or_pd(_mm_and_pd(better, gain), _mm_andnot_pd(better, best_gain));
+                best_index = _mm_or_pd(_mm_and_pd(better, index), _mm_andnot_pd(better, best_index));
+                index = _mm_add_pd(index, step);
+        }
+
+        distance_t gains[2];
+        distance_t indices[2];
+        _mm_storeu_pd(gains, best_gain);
+        _mm_storeu_pd(indices, best_index);
+        move = path_2_opt_reduce_lanes(gains, indices, 2, move);
+        return path_2_opt_kernel_scalar(xs, ys, nodes, xi, xi1, base, j, to, move);
+}
+
+__attribute__((target("avx2")))
+__m256d path_2_opt_distance_avx2(const __m256d x1, const __m256d y1, const __m256d x2, const __m256d y2) {
+        const __m256d dx = _mm256_sub_pd(x1, x2);
+        const __m256d dy = _mm256_sub_pd(y1, y2);
+        return _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+}
+
+__attribute__((target("avx2")))
+two_opt_move_t path_2_opt_kernel_avx2(const distance_t* xs, const distance_t* ys, const element_t* nodes, const element_t xi, const element_t xi1, const distance_t base, const size_t from, const size_t to, two_opt_move_t move) {
+        const __m256d xi_x = _mm256_set1_pd(xs[xi]);
+        const __m256d xi_y = _mm256_set1_pd(ys[xi]);
+        const __m256d xi1_x = _mm256_set1_pd(xs[xi1]);
+        const __m256d xi1_y = _mm256_set1_pd(ys[xi1]);
+        const __m256d base_gain = _mm256_set1_pd(base);
+        const __m256d step = _mm256_set1_pd(4);
+        __m256d best_gain = _mm256_set1_pd(move.gain);
+        __m256d best_index = _mm256_set1_pd(-1);
+        __m256d index = _mm256_set_pd(from + 3, from + 2, from + 1, from);
+
+        size_t j = from;
+        for (; j + 4 <= to ; j += 4) {
+                const __m128i xj = _mm_loadu_si128((const __m128i*) (nodes + j));
+                const __m128i xj1 = _mm_loadu_si128((const __m128i*) (nodes + j + 1));
+                const __m256d xj_x = _mm256_i32gather_pd(xs, xj, sizeof(distance_t));
+                const __m256d xj_y = _mm256_i32gather_pd(ys, xj, sizeof(distance_t));
+                const __m256d xj1_x = _mm256_i32gather_pd(xs, xj1, sizeof(distance_t));
+                const __m256d xj1_y = _mm256_i32gather_pd(ys, xj1, sizeof(distance_t));
+                const __m256d gain = _mm256_sub_pd(_mm256_sub_pd(
+                        _mm256_add_pd(base_gain, path_2_opt_distance_avx2(xj_x, xj_y, xj1_x, xj1_y)),
+                        path_2_opt_distance_avx2(xi_x, xi_y, xj_x, xj_y)),
+                        path_2_opt_distance_avx2(xi1_x, xi1_y, xj1_x, xj1_y));
+                const __m256d better = _mm256_cmp_pd(gain, best_gain, _CMP_GT_OQ);
+                best_gain = _mm256_blendv_pd(best_gain, gain, better);
+                best_index = _mm256_blendv_pd(best_index, index, better);
+                index = _mm256_add_pd(index, step);
+        }
+
+        distance_t gains[4];
+        distance_t indices[4];
+        _mm256_storeu_pd(gains, best_gain);
+        _mm256_storeu_pd(indices, best_index);
+        move = path_2_opt_reduce_lanes(gains, indices, 4, move);
+        return path_2_opt_kernel_scalar(xs, ys, nodes, xi, xi1, base, j, to, move);
+}
+#endif
+
+two_opt_kernel_t path_2_opt_kernel() {
+        static two_opt_kernel_t kernel = NULL;
+        if (kernel == NULL) {
+#ifdef PATH_2_OPT_SIMD
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2")) {
+                        kernel = path_2_opt_kernel_avx2;
+                } else {
+                        kernel = path_2_opt_kernel_sse2;
+                }
+#else
+                kernel = path_2_opt_kernel_scalar;
+#endif
+        }
+        return kernel;
+}
+
+two_opt_move_t path_2_opt_best_move_range(two_opt_kernel_t kernel, const graph_t* graph, const path_t* path, const element_t xi, const element_t xi1, const distance_t base, const size_t from, const size_t to, two_opt_move_t move) {
+        const size_t last = path->size - 1;
+        if (from >= to) {
+                return move;
+        }
+        if (from < last) {
+                move = kernel(graph->xs, graph->ys, path->node_indices, xi, xi1, base, from, to < last ? to : last, move);
+        }
+        if (to > last) {
+                const element_t xj = path_node_at(path, last);
+                const element_t xj1 = path_node_at(path, 0);
+                const distance_t current_improvement =
+                        base
+                        + gra_coordinates_distance(graph->xs, graph->ys, xj, xj1)
+                        - gra_coordinates_distance(graph->xs, graph->ys, xi, xj)
+                        - gra_coordinates_distance(graph->xs, graph->ys, xi1, xj1);
+                if (current_improvement > move.gain) {
+                        move.gain = current_improvement;
+                        move.index = last;
+                }
+        }
+        return move;
+}
+
+two_opt_move_t path_2_opt_best_move_with(two_opt_kernel_t kernel, const graph_t* graph, const path_t* path, const size_t starting_node, const size_t from, const size_t to) {
+        const element_t xi = path_node_at(path, starting_node);
+        const element_t xi1 = path_next(path, starting_node);
+        const distance_t base = gra_coordinates_distance(graph->xs, graph->ys, xi, xi1);
+        const size_t before_end = starting_node > 1 ? (starting_node - 1 < to ? starting_node - 1 : to) : 0;
+        const size_t after_start = starting_node + 2 > from ? starting_node + 2 : from;
+
+        two_opt_move_t move = { 0, 0 };
+        move = path_2_opt_best_move_range(kernel, graph, path, xi, xi1, base, from, before_end, move);
+        move = path_2_opt_best_move_range(kernel, graph, path, xi, xi1, base, after_start, to, move);
+        return move;
+}
+
+two_opt_move_t path_2_opt_best_move(const graph_t* graph, const path_t* path, const size_t starting_node, const size_t from, const size_t to) {
+        // the vector kernels compute unrounded euclidean distances
+        if (graph->matrix != NULL || graph->metric != GRA_EUCLIDEAN) {
+                return path_2_opt_best_move_reference(graph, path, starting_node, from, to);
+        }
+        return path_2_opt_best_move_with(path_2_opt_kernel(), graph, path, starting_node, from, to);
+}
+
+int path_2_opt_iteration(const graph_t* graph, path_t* path, const size_t starting_node, const size_t from, const size_t to) {
+        const two_opt_move_t move = path_2_opt_best_move(graph, path, starting_node, from, to);
+        if (move.gain > 0) {
+                if (path->neighborhood != NULL) {
+                        neighborhood_move_2_opt(graph, path->neighborhood, path_node_at(path, starting_node), path_next(path, starting_node), path_node_at(path, move.index), path_next(path, move.index));
+                }
+                path_revert_from_to(path, starting_node + 1, move.index + 1);
                 return 1;
         }
         return 0;
@@ -423,6 +1016,288 @@ void path_2_opt_iterate(const graph_t* graph, path_t* path, const size_t from, c
         while (path_2_opt_from_to(graph, path, from, to)) {}
 }
 
+// Reverses the cyclic run of positions from..to, or its complement when that
+// is shorter: both give the same tour.
+void path_revert_cyclic(path_t* path, element_t* positions, size_t from, size_t to) {
+        const size_t size = path->size;
+        size_t length = (to + size - from) % size + 1;
+        if (2 * length > size) {
+                const size_t complement_from = (to + 1) % size;
+                to = (from + size - 1) % size;
+                from = complement_from;
+                length = size - length;
+        }
+        for (size_t i=0 ; i<length / 2 ; i++) {
+                const element_t first = path->node_indices[from];
+                const element_t last = path->node_indices[to];
+                path->node_indices[from] = last;
+                path->node_indices[to] = first;
+                positions[last] = from;
+                positions[first] = to;
+                from = (from + 1) % size;
+                to = (to + size - 1) % size;
+        }
+}
+
+element_t path_successor(const path_t* path, const element_t* positions, const element_t node) {
+        return path->node_indices[(positions[node] + 1) % path->size];
+}
+
+element_t path_predecessor(const path_t* path, const element_t* positions, const element_t node) {
+        return path->node_indices[(positions[node] + path->size - 1) % path->size];
+}
+
+// Replaces the tour edges (x, y) and (u, v) by (x, u) and (y, v). Both edges
+// must be given in the same direction: y follows x when v follows u, or y
+// precedes x when v precedes u.
+void path_move_2_opt(const graph_t* graph, path_t* path, element_t* positions, const element_t x, const element_t y, const element_t u, const element_t v) {
+        if (path->neighborhood != NULL) {
+                neighborhood_move_2_opt(graph, path->neighborhood, x, y, u, v);
+        }
+        if (path_successor(path, positions, x) == y) {
+                path_revert_cyclic(path, positions, positions[y], positions[u]);
+        } else {
+                path_revert_cyclic(path, positions, positions[u], positions[y]);
+        }
+}
+
+#define PATH_LOCAL_SEARCH_TOUCHED 8
+#define PATH_OR_OPT_SEGMENT 3
+#define PATH_LK_DEPTH 3
+
+typedef size_t (*path_improve_node_t)(const graph_t*, path_t*, element_t*, element_t, element_t*);
+
+size_t path_2_opt_neighbors_node(const graph_t* graph, path_t* path, element_t* positions, const element_t a, element_t* touched) {
+        for (int forward=1 ; forward>=0 ; forward--) {
+                const element_t b = forward ? path_successor(path, positions, a) : path_predecessor(path, positions, a);
+                const distance_t ab = gra_distance_between_nodes(graph, a, b);
+                const element_t* neighbors = gra_neighbors(graph, a);
+                for (size_t k=0 ; k<graph->neighbor_count ; k++) {
+                        const element_t c = neighbors[k];
+                        const distance_t ac = gra_distance_between_nodes(graph, a, c);
+                        if (ac >= ab) {
+                                break;
+                        }
+                        const element_t d = forward ? path_successor(path, positions, c) : path_predecessor(path, positions, c);
+                        if (c == b || d == a) {
+                                continue;
+                        }
+                        const distance_t gain = ab + gra_distance_between_nodes(graph, c, d) - ac - gra_distance_between_nodes(graph, b, d);
+                        if (gain > PATH_2_OPT_EPSILON) {
+                                path_move_2_opt(graph, path, positions, a, b, c, d);
+                                touched[0] = a;
+                                touched[1] = b;
+                                touched[2] = c;
+                                touched[3] = d;
+                                return 4;
+                        }
+                }
+        }
+        return 0;
+}
+
+int path_or_opt_in_segment(const path_t* path, const element_t* positions, const element_t first, const size_t length, const element_t node) {
+        return (positions[node] + path->size - positions[first]) % path->size < length;
+}
+
+// Moves the segment first..last, possibly reversed, between c and e where e
+// follows c, through two or three successive 2-opt moves.
+void path_or_opt_move(const graph_t* graph, path_t* path, element_t* positions, const element_t p, const element_t first, const element_t last, const element_t n, const element_t c, const element_t e, const int reversed) {
+        path_move_2_opt(graph, path, positions, p, first, c, e);
+        path_move_2_opt(graph, path, positions, p, c, n, last);
+        if (!reversed) {
+                path_move_2_opt(graph, path, positions, c, last, first, e);
+        }
+}
+
+size_t path_or_opt_node(const graph_t* graph, path_t* path, element_t* positions, const element_t first, element_t* touched) {
+        const element_t p = path_predecessor(path, positions, first);
+        for (size_t length=1 ; length<=PATH_OR_OPT_SEGMENT && length + 3 <= path->size ; length++) {
+                const element_t last = path->node_indices[(positions[first] + length - 1) % path->size];
+                const element_t n = path_successor(path, positions, last);
+                const distance_t removal_gain =
+                        gra_distance_between_nodes(graph, p, first)
+                        + gra_distance_between_nodes(graph, last, n)
+                        - gra_distance_between_nodes(graph, p, n);
+                for (size_t end=0 ; end<2 ; end++) {
+                        const element_t u = end == 0 ? first : last;
+                        const element_t* neighbors = gra_neighbors(graph, u);
+                        for (size_t k=0 ; k<graph->neighbor_count ; k++) {
+                                const element_t candidate = neighbors[k];
+                                if (gra_distance_between_nodes(graph, u, candidate) >= removal_gain) {
+                                        break;
+                                }
+                                if (path_or_opt_in_segment(path, positions, first, length, candidate)) {
+                                        continue;
+                                }
+                                for (size_t side=0 ; side<2 ; side++) {
+                                        const element_t c = side == 0 ? candidate : path_predecessor(path, positions, candidate);
+                                        const element_t e = side == 0 ? path_successor(path, positions, candidate) : candidate;
+                                        if (c == p || c == n || e == p
+                                                        || path_or_opt_in_segment(path, positions, first, length, c)
+                                                        || path_or_opt_in_segment(path, positions, first, length, e)) {
+                                                continue;
+                                        }
+                                        const distance_t ce = gra_distance_between_nodes(graph, c, e);
+                                        const distance_t reversed_cost = gra_distance_between_nodes(graph, c, last) + gra_distance_between_nodes(graph, first, e) - ce;
+                                        const distance_t forward_cost = gra_distance_between_nodes(graph, c, first) + gra_distance_between_nodes(graph, last, e) - ce;
+                                        const int reversed = reversed_cost < forward_cost;
+                                        const distance_t gain = removal_gain - (reversed ? reversed_cost : forward_cost);
+                                        if (gain > PATH_2_OPT_EPSILON) {
+                                                path_or_opt_move(graph, path, positions, p, first, last, n, c, e, reversed);
+                                                touched[0] = p;
+                                                touched[1] = first;
+                                                touched[2] = last;
+                                                touched[3] = n;
+                                                touched[4] = c;
+                                                touched[5] = e;
+                                                return 6;
+                                        }
+                                }
+                        }
+                }
+        }
+        return 0;
+}
+
+// Lin-Kernighan style chain of 2-opt moves: the edge (t1, t2) is broken, t2 is
+// joined to a neighbor t3 and the tour is closed through t4, the neighbor of t3
+// on the same side. When closing does not improve the tour, the chain goes on
+// from (t1, t4) up to PATH_LK_DEPTH moves, and is undone if it never improves.
+size_t path_lk_node(const graph_t* graph, path_t* path, element_t* positions, const element_t t1, element_t* touched) {
+        element_t moves[PATH_LK_DEPTH][4];
+        for (int forward=1 ; forward>=0 ; forward--) {
+                const element_t first_t2 = forward ? path_successor(path, positions, t1) : path_predecessor(path, positions, t1);
+                const element_t* first_neighbors = gra_neighbors(graph, first_t2);
+                for (size_t first_k=0 ; first_k<graph->neighbor_count ; first_k++) {
+                        if (gra_distance_between_nodes(graph, first_t2, first_neighbors[first_k]) >= gra_distance_between_nodes(graph, t1, first_t2)) {
+                                break;
+                        }
+                        element_t t2 = first_t2;
+                        distance_t gain = gra_distance_between_nodes(graph, t1, t2);
+                        size_t depth = 0;
+                        for (; depth<PATH_LK_DEPTH ; depth++) {
+                                const int t1_follows = path_successor(path, positions, t2) == t1;
+                                const element_t* neighbors = gra_neighbors(graph, t2);
+                                const size_t first_candidate = depth == 0 ? first_k : 0;
+                                const size_t last_candidate = depth == 0 ? first_k + 1 : graph->neighbor_count;
+                                element_t best_t3 = t2;
+                                element_t best_t4 = t2;
+                                distance_t best_gain = 0;
+                                for (size_t k=first_candidate ; k<last_candidate ; k++) {
+                                        const element_t t3 = neighbors[k];
+                                        const distance_t partial_gain = gain - gra_distance_between_nodes(graph, t2, t3);
+                                        if (partial_gain <= 0) {
+                                                break;
+                                        }
+                                        const element_t t4 = t1_follows ? path_successor(path, positions, t3) : path_predecessor(path, positions, t3);
+                                        if (t3 == t1 || t4 == t2 || t4 == t1) {
+                                                continue;
+                                        }
+                                        const distance_t t3_gain = partial_gain + gra_distance_between_nodes(graph, t3, t4);
+                                        if (t3_gain > best_gain) {
+                                                best_gain = t3_gain;
+                                                best_t3 = t3;
+                                                best_t4 = t4;
+                                        }
+                                }
+                                if (best_t3 == t2) {
+                                        break;
+                                }
+
+                                path_move_2_opt(graph, path, positions, t2, t1, best_t3, best_t4);
+                                moves[depth][0] = t2;
+                                moves[depth][1] = t1;
+                                moves[depth][2] = best_t3;
+                                moves[depth][3] = best_t4;
+
+                                if (best_gain - gra_distance_between_nodes(graph, best_t4, t1) > PATH_2_OPT_EPSILON) {
+                                        touched[0] = t1;
+                                        for (size_t i=0 ; i<=depth ; i++) {
+                                                touched[1 + 2 * i] = moves[i][0];
+                                                touched[2 + 2 * i] = moves[i][2];
+                                        }
+                                        touched[2 * depth + 3] = best_t4;
+                                        return 2 * depth + 4;
+                                }
+                                gain = best_gain;
+                                t2 = best_t4;
+                        }
+                        while (depth > 0) {
+                                depth--;
+                                path_move_2_opt(graph, path, positions, moves[depth][0], moves[depth][2], moves[depth][1], moves[depth][3]);
+                        }
+                }
+        }
+        return 0;
+}
+
+// Runs the improve function with don't-look bits: only the count nodes
+// starting at position from, and the nodes touched by applied moves, are
+// examined, until max_moves improving moves are applied. Returns the number
+// of improving moves applied.
+size_t path_local_search(const graph_t* graph, path_t* path, const path_improve_node_t improve, const size_t from, const size_t count, const size_t max_moves) {
+        const size_t size = path->size;
+        if (graph->neighbor_lists == NULL || size < 5) {
+                return 0;
+        }
+
+        element_t* positions = path->positions;
+        if (positions == NULL) {
+                positions = pool_calloc(size, sizeof(element_t));
+                for (size_t i=0 ; i<size ; i++) {
+                        positions[path->node_indices[i]] = i;
+                }
+        }
+        char* queued = pool_calloc(size, sizeof(char));
+        element_t* queue = pool_calloc(size, sizeof(element_t));
+        size_t head = 0;
+        size_t queue_size = 0;
+        for (size_t i=0 ; i<count && i<size ; i++) {
+                const element_t node = path->node_indices[(from + i) % size];
+                queue[queue_size++] = node;
+                queued[node] = 1;
+        }
+
+        size_t moves = 0;
+        element_t touched[PATH_LOCAL_SEARCH_TOUCHED];
+        while (queue_size > 0 && moves < max_moves) {
+                const element_t node = queue[head];
+                head = (head + 1) % size;
+                queue_size--;
+                queued[node] = 0;
+                const size_t touched_count = improve(graph, path, positions, node, touched);
+                if (touched_count > 0) {
+                        moves++;
+                }
+                for (size_t i=0 ; i<touched_count ; i++) {
+                        if (!queued[touched[i]]) {
+                                queue[(head + queue_size++) % size] = touched[i];
+                                queued[touched[i]] = 1;
+                        }
+                }
+        }
+
+        pool_free(queue, size * sizeof(element_t));
+        pool_free(queued, size * sizeof(char));
+        if (positions != path->positions) {
+                pool_free(positions, size * sizeof(element_t));
+        }
+        return moves;
+}
+
+size_t path_2_opt_neighbors(const graph_t* graph, path_t* path, const size_t from, const size_t count) {
+        return path_local_search(graph, path, path_2_opt_neighbors_node, from, count, SIZE_MAX);
+}
+
+size_t path_or_opt(const graph_t* graph, path_t* path, const size_t from, const size_t count) {
+        return path_local_search(graph, path, path_or_opt_node, from, count, SIZE_MAX);
+}
+
+size_t path_lk_opt(const graph_t* graph, path_t* path, const size_t from, const size_t count) {
+        return path_local_search(graph, path, path_lk_node, from, count, SIZE_MAX);
+}
+
 graph_t* gra_read(const char* filename) {
         FILE *file = fopen(filename, "r");
         if (file == NULL) {
@@ -439,9 +1314,246 @@ graph_t* gra_read(const char* filename) {
                         printf("Error reading graph!\n");
                         exit(1);
                 }
-                graph->nodes[i].metadata = point_of(x, y);
+                gra_set_point(graph, i, point_of(x, y));
+        }
+        fclose(file);
+        return graph;
+}
+
+// TSPLIB EDGE_WEIGHT_FORMAT values, the flags tell which cells a row holds.
+#define GRA_TSPLIB_LOWER 1
+#define GRA_TSPLIB_DIAGONAL 2
+#define GRA_TSPLIB_UPPER 4
+
+typedef struct {
+        const char* name;
+        int value;
+} gra_tsplib_keyword_t;
+
+const gra_tsplib_keyword_t gra_tsplib_metrics[] = {
+        { "EUC_2D", GRA_EUC_2D },
+        { "CEIL_2D", GRA_CEIL_2D },
+        { "GEO", GRA_GEO },
+        { "ATT", GRA_ATT },
+        { "EXPLICIT", GRA_EXPLICIT },
+        { NULL, -1 }
+};
+
+const gra_tsplib_keyword_t gra_tsplib_formats[] = {
+        { "FULL_MATRIX", GRA_TSPLIB_LOWER | GRA_TSPLIB_DIAGONAL | GRA_TSPLIB_UPPER },
+        { "UPPER_ROW", GRA_TSPLIB_UPPER },
+        { "LOWER_ROW", GRA_TSPLIB_LOWER },
+        { "UPPER_DIAG_ROW", GRA_TSPLIB_DIAGONAL | GRA_TSPLIB_UPPER },
+        { "LOWER_DIAG_ROW", GRA_TSPLIB_LOWER | GRA_TSPLIB_DIAGONAL },
+        { NULL, -1 }
+};
+
+int gra_tsplib_lookup(const gra_tsplib_keyword_t* keywords, const char* name) {
+        for (; keywords->name != NULL ; keywords++) {
+                if (strcmp(keywords->name, name) == 0) {
+                        break;
+                }
+        }
+        return keywords->value;
+}
+
+void gra_tsplib_error(const char* message, const char* detail) {
+        printf("Error reading graph: %s %s\n", message, detail);
+        exit(1);
+}
+
+void gra_tsplib_read_coordinates(FILE* file, graph_t* graph) {
+        for (size_t i=0 ; i<graph->size ; i++) {
+                size_t node;
+                double x;
+                double y;
+                if (fscanf(file, "%zu %lf %lf", &node, &x, &y) != 3 || node < 1 || node > graph->size) {
+                        gra_tsplib_error("bad coordinates", "");
+                }
+                gra_set_point(graph, node - 1, point_of(x, y));
+        }
+}
+
+void gra_tsplib_read_weights(FILE* file, graph_t* graph, const int format) {
+        graph->matrix = gra_allocate_distance_matrix(graph);
+        if (graph->matrix == NULL) {
+                gra_tsplib_error("no memory for the distance matrix", "");
+        }
+        for (element_t i=0 ; i<graph->size ; i++) {
+                const element_t first = format & GRA_TSPLIB_LOWER ? 0 : (format & GRA_TSPLIB_DIAGONAL ? i : i + 1);
+                const element_t last = format & GRA_TSPLIB_UPPER ? graph->size : (format & GRA_TSPLIB_DIAGONAL ? i + 1 : i);
+                for (element_t j=first ; j<last ; j++) {
+                        double weight;
+                        if (fscanf(file, "%lf", &weight) != 1) {
+                                gra_tsplib_error("missing edge weights", "");
+                        }
+                        graph->matrix[gra_matrix_index(graph, i, j)] = weight;
+                        graph->matrix[gra_matrix_index(graph, j, i)] = weight;
+                }
+        }
+}
+
+char* gra_tsplib_trim(char* text) {
+        while (isspace((unsigned char) *text)) {
+                text++;
+        }
+        size_t length = strlen(text);
+        while (length > 0 && isspace((unsigned char) text[length - 1])) {
+                text[--length] = 0;
+        }
+        return text;
+}
+
+// Reads a symmetric TSPLIB instance in a single pass: the specification lines,
+// read one at a time as KEYWORD : VALUE, set the dimension and the metric,
+// then each section is read as it comes.
+graph_t* gra_read_tsplib(const char* filename) {
+        FILE *file = fopen(filename, "r");
+        if (file == NULL) {
+                printf("Error reading file!\n");
+                exit(1);
+        }
+        char line[256];
+        size_t size = 0;
+        int metric = GRA_EUCLIDEAN;
+        int format = -1;
+        graph_t* graph = NULL;
+        while (fgets(line, sizeof(line), file) != NULL) {
+                if (strchr(line, '\n') == NULL) {
+                        // only the start of overlong lines is kept
+                        fscanf(file, "%*[^\n]");
+                }
+                char* separator = strchr(line, ':');
+                char* value = gra_tsplib_trim(separator != NULL ? separator + 1 : line + strlen(line));
+                if (separator != NULL) {
+                        *separator = 0;
+                }
+                const char* keyword = gra_tsplib_trim(line);
+                if (strcmp(keyword, "EOF") == 0) {
+                        break;
+                }
+                if (strstr(keyword, "_SECTION") != NULL && graph == NULL) {
+                        gra_tsplib_error("no DIMENSION before", keyword);
+                }
+                if (strcmp(keyword, "NODE_COORD_SECTION") == 0 || strcmp(keyword, "DISPLAY_DATA_SECTION") == 0) {
+                        gra_tsplib_read_coordinates(file, graph);
+                } else if (strcmp(keyword, "EDGE_WEIGHT_SECTION") == 0) {
+                        if (format < 0) {
+                                gra_tsplib_error("unsupported EDGE_WEIGHT_FORMAT", "");
+                        }
+                        gra_tsplib_read_weights(file, graph, format);
+                } else if (strcmp(keyword, "DIMENSION") == 0) {
+                        size = strtoul(value, NULL, 10);
+                } else if (strcmp(keyword, "EDGE_WEIGHT_TYPE") == 0) {
+                        if ((metric = gra_tsplib_lookup(gra_tsplib_metrics, value)) < 0) {
+                                gra_tsplib_error("unsupported EDGE_WEIGHT_TYPE", value);
+                        }
+                } else if (strcmp(keyword, "EDGE_WEIGHT_FORMAT") == 0) {
+                        format = gra_tsplib_lookup(gra_tsplib_formats, value);
+                } else if (strcmp(keyword, "TYPE") == 0 && strncmp(value, "TSP", 3) != 0) {
+                        gra_tsplib_error("unsupported TYPE", value);
+                }
+                if (graph == NULL && size > 0) {
+                        graph = gra_create(size);
+                }
         }
         fclose(file);
+        if (graph == NULL || (metric == GRA_EXPLICIT && graph->matrix == NULL)) {
+                gra_tsplib_error("incomplete instance", filename);
+        }
+        gra_set_metric(graph, metric);
+        return graph;
+}
+
+void gra_save(const char* filename, const graph_t* graph) {
+        FILE *file = fopen(filename, "w");
+        if (file == NULL) {
+                printf("Error opening file!\n");
+                exit(1);
+        }
+        fprintf(file, "%zu\n", graph->size);
+        for (size_t i=0 ; i<graph->size ; i++) {
+                fprintf(file, "%.17g,%.17g\n", graph->xs[i], graph->ys[i]);
+        }
+        fclose(file);
+}
+
+// Binary instances hold this header, padded to GRA_ALIGNMENT, followed by the
+// xs then the ys, each padded to stride coordinates, in native byte order.
+#define GRA_BINARY_MAGIC "GATSP01"
+
+typedef struct {
+        char magic[8];
+        uint64_t size;
+        uint64_t stride;
+        uint64_t metric;
+} gra_binary_header_t;
+
+void gra_save_binary(const char* filename, const graph_t* graph) {
+        FILE *file = fopen(filename, "wb");
+        if (file == NULL) {
+                printf("Error opening file!\n");
+                exit(1);
+        }
+        char header[gra_align(sizeof(gra_binary_header_t))];
+        memset(header, 0, sizeof(header));
+        gra_binary_header_t* binary_header = (gra_binary_header_t*) header;
+        memcpy(binary_header->magic, GRA_BINARY_MAGIC, sizeof(binary_header->magic));
+        binary_header->size = graph->size;
+        binary_header->stride = gra_coordinates_stride(graph->size);
+        binary_header->metric = graph->metric;
+        if (graph->metric == GRA_EXPLICIT) {
+                printf("Error writing graph: explicit distances have no binary format\n");
+                exit(1);
+        }
+
+        const size_t padding = binary_header->stride - graph->size;
+        const distance_t zeros[GRA_ALIGNMENT / sizeof(distance_t)] = { 0 };
+        if (fwrite(header, sizeof(header), 1, file) != 1
+                        || fwrite(graph->xs, sizeof(distance_t), graph->size, file) != graph->size
+                        || fwrite(zeros, sizeof(distance_t), padding, file) != padding
+                        || fwrite(graph->ys, sizeof(distance_t), graph->size, file) != graph->size
+                        || fwrite(zeros, sizeof(distance_t), padding, file) != padding) {
+                printf("Error writing graph!\n");
+                exit(1);
+        }
+        fclose(file);
+}
+
+// Maps a binary instance and uses it as the coordinate storage: nothing is
+// parsed or copied, pages are read on first access. The mapping is private,
+// so writing coordinates never changes the file.
+graph_t* gra_map_binary(const char* filename) {
+        const int descriptor = open(filename, O_RDONLY);
+        if (descriptor < 0) {
+                printf("Error reading file!\n");
+                exit(1);
+        }
+        struct stat status;
+        if (fstat(descriptor, &status) != 0) {
+                close(descriptor);
+                printf("Error reading file!\n");
+                exit(1);
+        }
+        const size_t file_size = status.st_size;
+        void* mapping = file_size >= sizeof(gra_binary_header_t) ? mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0) : MAP_FAILED;
+        close(descriptor);
+
+        const gra_binary_header_t* header = mapping;
+        if (mapping == MAP_FAILED || memcmp(header->magic, GRA_BINARY_MAGIC, sizeof(header->magic)) != 0
+                        || header->stride != gra_coordinates_stride(header->size) || header->metric >= GRA_EXPLICIT
+                        || file_size < gra_align(sizeof(gra_binary_header_t)) + 2 * header->stride * sizeof(distance_t)) {
+                printf("Error reading graph!\n");
+                exit(1);
+        }
+
+        graph_t* graph = calloc(1, sizeof(graph_t));
+        graph->size = header->size;
+        graph->xs = (distance_t*) ((char*) mapping + gra_align(sizeof(gra_binary_header_t)));
+        graph->ys = graph->xs + header->stride;
+        graph->mapping = mapping;
+        graph->mapping_size = file_size;
+        gra_set_metric(graph, header->metric);
         return graph;
 }
 
@@ -453,7 +1565,7 @@ void path_save(const char* filename, const graph_t* graph, const path_t* path) {
         }
         for (size_t i=0 ; i<path->size ; i++) {
                 const size_t current_node = path->node_indices[i];
-                fprintf(file, "%zu,%f,%f\n", current_node, graph->nodes[current_node].metadata->x, graph->nodes[current_node].metadata->y);
+                fprintf(file, "%zu,%f,%f\n", current_node, graph->xs[current_node], graph->ys[current_node]);
         }
         fclose(file);
 }
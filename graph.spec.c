@@ -2,8 +2,10 @@
 
 #include "graph.c"
 
+rng_t test_rng;
+
 void testPathShift(size_t size) {
-        graph_t* graph = gra_generate_random_graph(size);
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
         path_t* path = path_generate_simple(graph);
         path_print(graph, path);
         path_shift(path, 10);
@@ -13,7 +15,7 @@ void testPathShift(size_t size) {
 }
 
 void testPathRevert(size_t size) {
-        graph_t* graph = gra_generate_random_graph(size);
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
         path_t* path = path_generate_simple(graph);
         path_print(graph, path);
         path_revert(path);
@@ -32,7 +34,8 @@ void testNeighborhood(const graph_t* graph) {
         for (size_t i=0 ; i<path1->size ; i++) {
                 printf("- Node %zu neighbors:\n", i);
                 for (size_t j=0 ; j<2 ; j++) {
-                        printf("  - %u by %f\n", neighborhood_neighbors(neighborhood, i, j)->node, neighborhood_neighbors(neighborhood, i, j)->distance);
+                        const element_t neighbor = neighborhood_neighbor(neighborhood, i, j);
+                        printf("  - %u by %f\n", neighbor, gra_distance_between_nodes(graph, i, neighbor));
                 }
         }
 }
@@ -85,7 +88,288 @@ void test_path_2_opt() {
         gra_destroy_graph(graph);
 }
 
+void test_distance_matrix(size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+
+        assert(!gra_enable_distance_matrix(graph, gra_matrix_memory(size) - 1));
+        assert(graph->matrix == NULL);
+
+        assert(gra_enable_distance_matrix(graph, GRA_MATRIX_MEMORY_LIMIT));
+        for (element_t i=0 ; i<size ; i++) {
+                for (element_t j=0 ; j<size ; j++) {
+                        assert(gra_distance_between_nodes(graph, i, j) == (matrix_distance_t) gra_compute_distance(graph, i, j));
+                }
+        }
+
+        // a refused or repeated enable keeps a working matrix
+        assert(!gra_enable_distance_matrix(graph, gra_matrix_memory(size) - 1));
+        assert(graph->matrix != NULL);
+        assert(gra_enable_distance_matrix(graph, GRA_MATRIX_MEMORY_LIMIT));
+        assert(gra_distance_between_nodes(graph, 1, size - 1) == (matrix_distance_t) gra_compute_distance(graph, 1, size - 1));
+
+        gra_destroy_graph(graph);
+}
+
+void assert_same_2_opt_move(const two_opt_move_t expected, const two_opt_move_t actual) {
+        assert(expected.index == actual.index);
+        assert(fabs(expected.gain - actual.gain) <= 1e-9 * fabs(expected.gain));
+}
+
+void test_path_2_opt_kernels(size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        path_t* path = path_generate_simple(graph);
+        two_opt_kernel_t kernels[] = {
+                path_2_opt_kernel_scalar,
+#ifdef PATH_2_OPT_SIMD
+                path_2_opt_kernel_sse2,
+                __builtin_cpu_supports("avx2") ? path_2_opt_kernel_avx2 : path_2_opt_kernel_sse2,
+#endif
+        };
+
+        for (size_t round=0 ; round<4 ; round++) {
+                path_randomize(graph, path, &test_rng);
+                for (size_t from=0 ; from<size ; from+=size/3) {
+                        for (size_t i=from ; i<size ; i++) {
+                                const two_opt_move_t expected = path_2_opt_best_move_reference(graph, path, i, from, size);
+                                for (size_t k=0 ; k<sizeof(kernels) / sizeof(two_opt_kernel_t) ; k++) {
+                                        assert_same_2_opt_move(expected, path_2_opt_best_move_with(kernels[k], graph, path, i, from, size));
+                                }
+                        }
+                }
+        }
+
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
+void test_local_search(size_t size, size_t (*local_search) (const graph_t*, path_t*, size_t, size_t)) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        gra_build_neighbor_lists(graph, GRA_NEIGHBOR_COUNT);
+        path_t* path = path_generate_simple(graph);
+        path_randomize(graph, path, &test_rng);
+        const distance_t initial_length = path_length(graph, path);
+
+        assert(local_search(graph, path, 0, path->size) > 0);
+        const distance_t optimized_length = path_length(graph, path);
+        assert(optimized_length < initial_length);
+        local_search(graph, path, 0, path->size);
+        assert(path_length(graph, path) <= optimized_length);
+
+        ensemble_t* visited = ens_create(size);
+        ens_add_elements(visited, path->node_indices, path->size);
+        for (element_t i=0 ; i<size ; i++) {
+                assert(ens_contains(visited, i));
+        }
+
+        ens_destroy(visited);
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
+void assert_positions_consistent(const path_t* path) {
+        assert(path->positions != NULL);
+        for (size_t i=0 ; i<path->size ; i++) {
+                assert(path->positions[path->node_indices[i]] == i);
+        }
+}
+
+void assert_neighborhood_consistent(const graph_t* graph, const path_t* path) {
+        neighborhood_t* expected = neighborhood_from_path(graph, path);
+        assert(fabs(expected->length - path->neighborhood->length) < 1e-6 * expected->length);
+        for (element_t node=0 ; node<path->size ; node++) {
+                for (size_t i=0 ; i<2 ; i++) {
+                        const element_t neighbor = neighborhood_neighbor(path->neighborhood, node, i);
+                        const element_t other = neighborhood_neighbor(path->neighborhood, node, 1 - i);
+                        assert(neighbor == neighborhood_neighbor(expected, node, 0) || neighbor == neighborhood_neighbor(expected, node, 1));
+                        assert(other != neighbor);
+                }
+        }
+        neighborhood_destroy(expected);
+}
+
+void test_neighborhood_updates(size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        gra_build_neighbor_lists(graph, GRA_NEIGHBOR_COUNT);
+        path_t* path = path_generate_simple(graph);
+        path_randomize(graph, path, &test_rng);
+        path->neighborhood = neighborhood_from_path(graph, path);
+
+        for (size_t i=0 ; i<100 ; i++) {
+                path_exchange_nodes(graph, path, rng_below(&test_rng, size), rng_below(&test_rng, size));
+                assert_neighborhood_consistent(graph, path);
+        }
+        for (size_t i=0 ; i+1<size ; i+=1+size/10) {
+                path_exchange_nodes(graph, path, i, i + 1);
+                assert_neighborhood_consistent(graph, path);
+        }
+        for (size_t i=0 ; i<10 ; i++) {
+                path_2_opt_from_to(graph, path, 0, size);
+                assert_neighborhood_consistent(graph, path);
+        }
+        path_2_opt_neighbors(graph, path, 0, size);
+        assert_neighborhood_consistent(graph, path);
+        path_or_opt(graph, path, 0, size);
+        assert_neighborhood_consistent(graph, path);
+        path_lk_opt(graph, path, 0, size);
+        assert_neighborhood_consistent(graph, path);
+        path_rotate(path, size / 3, 1);
+        assert_neighborhood_consistent(graph, path);
+
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
+void test_path_positions(size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        gra_build_neighbor_lists(graph, GRA_NEIGHBOR_COUNT);
+        path_t* path = path_generate_simple(graph);
+        assert_positions_consistent(path);
+
+        path_randomize(graph, path, &test_rng);
+        assert_positions_consistent(path);
+        path_revert_from_to(path, 3, size / 2);
+        assert_positions_consistent(path);
+        path_set_starting_node(path, 0);
+        assert(path->node_indices[0] == 0);
+        assert_positions_consistent(path);
+        path_lk_opt(graph, path, 0, size);
+        assert_positions_consistent(path);
+
+        path_t* copy = path_copy(path);
+        assert_positions_consistent(copy);
+        path_destroy(copy);
+        path_destroy(path);
+
+        path_set_positions_enabled(0);
+        path = path_generate_simple(graph);
+        assert(path->positions == NULL);
+        path_randomize(graph, path, &test_rng);
+        path_set_starting_node(path, 0);
+        assert(path->node_indices[0] == 0);
+        path_destroy(path);
+        path_set_positions_enabled(1);
+
+        gra_destroy_graph(graph);
+}
+
+void test_path_rotate(size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        path_t* path = path_generate_simple(graph);
+        path_randomize(graph, path, &test_rng);
+
+        for (size_t shift=0 ; shift<size ; shift++) {
+                for (int reversed=0 ; reversed<2 ; reversed++) {
+                        path_t* expected = path_copy(path);
+                        path_t* actual = path_copy(path);
+                        // built by hand, independently of path_rotate
+                        for (size_t i=0 ; i<size ; i++) {
+                                const size_t from = reversed ? (shift + size - i) % size : (shift + i) % size;
+                                expected->node_indices[i] = path->node_indices[from];
+                        }
+                        path_index_positions(expected);
+                        path_rotate(actual, shift, reversed);
+                        assert(path_cmp(expected, actual) == 0);
+                        assert(path_hash(actual) == path_hash(path));
+                        assert_positions_consistent(actual);
+                        path_destroy(actual);
+                        path_destroy(expected);
+                }
+        }
+
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
+void test_binary_instance(const size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        gra_save_binary("graph_test.bin", graph);
+        graph_t* mapped = gra_map_binary("graph_test.bin");
+        remove("graph_test.bin");
+
+        assert(mapped->size == size);
+        assert((size_t) mapped->xs % GRA_ALIGNMENT == 0);
+        assert((size_t) mapped->ys % GRA_ALIGNMENT == 0);
+        for (element_t i=0 ; i<size ; i++) {
+                assert(mapped->xs[i] == graph->xs[i]);
+                assert(mapped->ys[i] == graph->ys[i]);
+        }
+        gra_destroy_graph(mapped);
+        gra_destroy_graph(graph);
+}
+
+graph_t* read_tsplib_text(const char* text) {
+        FILE* file = fopen("graph_test.tsp", "w");
+        fputs(text, file);
+        fclose(file);
+        graph_t* graph = gra_read_tsplib("graph_test.tsp");
+        remove("graph_test.tsp");
+        return graph;
+}
+
+void test_tsplib_coordinates() {
+        const char* coordinates = "DIMENSION : 3\nNODE_COORD_SECTION\n1 0 0\n2 1 1\n3 10 0\nEOF\n";
+        char text[1024];
+        // a comment longer than the lines the reader keeps
+        char comment[300];
+        memset(comment, 'c', sizeof(comment) - 1);
+        comment[sizeof(comment) - 1] = 0;
+
+        sprintf(text, "NAME : test\nCOMMENT : %s\nTYPE : TSP\nEDGE_WEIGHT_TYPE : EUC_2D\n%s", comment, coordinates);
+        graph_t* graph = read_tsplib_text(text);
+        assert(graph->size == 3 && graph->metric == GRA_EUC_2D);
+        assert(gra_distance_between_nodes(graph, 0, 1) == 1);
+        assert(gra_distance_between_nodes(graph, 0, 2) == 10);
+        gra_destroy_graph(graph);
+
+        // an empty value must not swallow the next line
+        sprintf(text, "NAME : test\nCOMMENT :\nEDGE_WEIGHT_TYPE : EUC_2D\n%s", coordinates);
+        graph = read_tsplib_text(text);
+        assert(graph->size == 3 && graph->metric == GRA_EUC_2D);
+        gra_destroy_graph(graph);
+
+        sprintf(text, "EDGE_WEIGHT_TYPE: CEIL_2D\n%s", coordinates);
+        graph = read_tsplib_text(text);
+        assert(gra_distance_between_nodes(graph, 0, 1) == 2);
+        gra_destroy_graph(graph);
+
+        sprintf(text, "EDGE_WEIGHT_TYPE : ATT\n%s", coordinates);
+        graph = read_tsplib_text(text);
+        assert(gra_distance_between_nodes(graph, 0, 2) == 4);
+        assert(gra_enable_distance_matrix(graph, GRA_MATRIX_MEMORY_LIMIT));
+        assert(gra_distance_between_nodes(graph, 2, 0) == 4);
+        gra_destroy_graph(graph);
+
+        // one degree along the equator, TSPLIB rounds geographical distances up
+        graph = read_tsplib_text("DIMENSION : 2\nEDGE_WEIGHT_TYPE : GEO\nNODE_COORD_SECTION\n1 0.0 0.0\n2 0.0 1.0\nEOF\n");
+        assert(gra_distance_between_nodes(graph, 0, 1) == 112);
+        assert(gra_distance_between_nodes(graph, 1, 1) == 1);
+        gra_destroy_graph(graph);
+}
+
+void test_tsplib_explicit(const char* format, const char* weights) {
+        char text[512];
+        sprintf(text, "TYPE : TSP\nDIMENSION : 4\nEDGE_WEIGHT_TYPE : EXPLICIT\nEDGE_WEIGHT_FORMAT : %s\nEDGE_WEIGHT_SECTION\n%s\nEOF\n", format, weights);
+        graph_t* graph = read_tsplib_text(text);
+        assert(graph->metric == GRA_EXPLICIT);
+        const distance_t expected[4][4] = { { 0, 1, 2, 3 }, { 1, 0, 4, 5 }, { 2, 4, 0, 6 }, { 3, 5, 6, 0 } };
+        for (element_t i=0 ; i<4 ; i++) {
+                for (element_t j=0 ; j<4 ; j++) {
+                        assert(gra_distance_between_nodes(graph, i, j) == expected[i][j]);
+                }
+        }
+        gra_disable_distance_matrix(graph);
+        assert(gra_distance_between_nodes(graph, 3, 2) == 6);
+
+        gra_build_neighbor_lists(graph, 2);
+        assert(gra_neighbors(graph, 3)[0] == 0 && gra_neighbors(graph, 3)[1] == 1);
+        path_t* path = path_generate_simple(graph);
+        assert(path_length(graph, path) == 1 + 4 + 6 + 3);
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
 int main(int argc, char** argv) {
+        rng_seed(&test_rng, 42);
         graph_t* graph_length_8 = gra_of(8,
                 point_of(0, 0),
                 point_of(0, 1),
@@ -102,4 +386,22 @@ int main(int argc, char** argv) {
         testPathShift(16);
         testPathRevert(16);
         testNeighborhood(graph_length_8);
+        test_distance_matrix(100);
+        test_path_2_opt_kernels(5);
+        test_path_2_opt_kernels(103);
+        test_local_search(500, path_2_opt_neighbors);
+        test_local_search(500, path_or_opt);
+        test_local_search(500, path_lk_opt);
+        test_neighborhood_updates(6);
+        test_neighborhood_updates(300);
+        test_path_positions(200);
+        test_path_rotate(1);
+        test_path_rotate(12);
+        test_path_rotate(37);
+        test_binary_instance(1);
+        test_binary_instance(1000);
+        test_tsplib_coordinates();
+        test_tsplib_explicit("FULL_MATRIX", "0 1 2 3\n1 0 4 5\n2 4 0 6\n3 5 6 0");
+        test_tsplib_explicit("UPPER_ROW", "1 2 3\n4 5\n6");
+        test_tsplib_explicit("LOWER_DIAG_ROW", "0 1 0 2 4 0 3 5 6 0");
 }
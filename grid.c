@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#define GRID_NODES_PER_CELL 2
+
+typedef struct {
+        size_t size;
+        size_t columns;
+        size_t rows;
+        double min_x;
+        double min_y;
+        double cell_size;
+        const double* xs;
+        const double* ys;
+        size_t* cell_start;
+        size_t* cell_count;
+        element_t* cell_nodes;
+        size_t* slots;
+} grid_t;
+
+size_t grid_column(const grid_t* grid, const double x) {
+        const size_t column = (x - grid->min_x) / grid->cell_size;
+        return column < grid->columns ? column : grid->columns - 1;
+}
+
+size_t grid_row(const grid_t* grid, const double y) {
+        const size_t row = (y - grid->min_y) / grid->cell_size;
+        return row < grid->rows ? row : grid->rows - 1;
+}
+
+size_t grid_cell_of(const grid_t* grid, const element_t node) {
+        return grid_row(grid, grid->ys[node]) * grid->columns + grid_column(grid, grid->xs[node]);
+}
+
+grid_t* grid_create(const double* xs, const double* ys, const size_t size) {
+        grid_t* grid = calloc(1, sizeof(grid_t));
+        grid->size = size;
+        grid->xs = xs;
+        grid->ys = ys;
+
+        double max_x = size > 0 ? xs[0] : 0;
+        double max_y = size > 0 ? ys[0] : 0;
+        grid->min_x = max_x;
+        grid->min_y = max_y;
+        for (size_t i=1 ; i<size ; i++) {
+                grid->min_x = fmin(grid->min_x, xs[i]);
+                grid->min_y = fmin(grid->min_y, ys[i]);
+                max_x = fmax(max_x, xs[i]);
+                max_y = fmax(max_y, ys[i]);
+        }
+
+        const double width = max_x - grid->min_x;
+        const double height = max_y - grid->min_y;
+        const double cells = size / GRID_NODES_PER_CELL + 1;
+        grid->cell_size = fmax(sqrt(width * height / cells), fmax(width, height) / cells);
+        if (grid->cell_size <= 0) {
+                grid->cell_size = 1;
+        }
+        grid->columns = width / grid->cell_size + 1;
+        grid->rows = height / grid->cell_size + 1;
+
+        const size_t cell_count = grid->columns * grid->rows;
+        grid->cell_start = calloc(cell_count + 1, sizeof(size_t));
+        grid->cell_count = calloc(cell_count, sizeof(size_t));
+        grid->cell_nodes = calloc(size, sizeof(element_t));
+        grid->slots = calloc(size, sizeof(size_t));
+
+        for (element_t i=0 ; i<size ; i++) {
+                grid->cell_count[grid_cell_of(grid, i)]++;
+        }
+        for (size_t c=0 ; c<cell_count ; c++) {
+                grid->cell_start[c + 1] = grid->cell_start[c] + grid->cell_count[c];
+                grid->cell_count[c] = 0;
+        }
+        for (element_t i=0 ; i<size ; i++) {
+                const size_t cell = grid_cell_of(grid, i);
+                const size_t slot = grid->cell_start[cell] + grid->cell_count[cell]++;
+                grid->cell_nodes[slot] = i;
+                grid->slots[i] = slot;
+        }
+
+        return grid;
+}
+
+void grid_remove(grid_t* grid, const element_t node) {
+        const size_t cell = grid_cell_of(grid, node);
+        const size_t slot = grid->slots[node];
+        const size_t last = grid->cell_start[cell] + grid->cell_count[cell] - 1;
+        const element_t moved = grid->cell_nodes[last];
+        grid->cell_nodes[slot] = moved;
+        grid->slots[moved] = slot;
+        grid->cell_nodes[last] = node;
+        grid->slots[node] = last;
+        grid->cell_count[cell]--;
+}
+
+size_t grid_insert_candidate(const size_t k, size_t found, element_t* nodes, double* distances, const element_t node, const double distance) {
+        if (found == k && distance >= distances[k - 1]) {
+                return found;
+        }
+        size_t i = k - 1;
+        if (found < k) {
+                i = found;
+                found++;
+        }
+        for (; i>0 && distances[i - 1] > distance ; i--) {
+                nodes[i] = nodes[i - 1];
+                distances[i] = distances[i - 1];
+        }
+        nodes[i] = node;
+        distances[i] = distance;
+        return found;
+}
+
+size_t grid_scan_cell(const grid_t* grid, const size_t cell, const double x, const double y, const size_t k, const element_t exclude, size_t found, element_t* nodes, double* distances) {
+        const size_t end = grid->cell_start[cell] + grid->cell_count[cell];
+        for (size_t slot=grid->cell_start[cell] ; slot<end ; slot++) {
+                const element_t node = grid->cell_nodes[slot];
+                if (node == exclude) {
+                        continue;
+                }
+                const double dx = x - grid->xs[node];
+                const double dy = y - grid->ys[node];
+                found = grid_insert_candidate(k, found, nodes, distances, node, sqrt(dx*dx + dy*dy));
+        }
+        return found;
+}
+
+// Finds up to k nodes still in the grid closest to (x, y), sorted by distance,
+// visiting cells in growing square rings around the cell containing the point.
+size_t grid_nearest(const grid_t* grid, const double x, const double y, const size_t k, const element_t exclude, element_t* nodes, double* distances) {
+        const size_t column = grid_column(grid, x);
+        const size_t row = grid_row(grid, y);
+        size_t max_ring = column > grid->columns - 1 - column ? column : grid->columns - 1 - column;
+        if (row > max_ring) {
+                max_ring = row;
+        }
+        if (grid->rows - 1 - row > max_ring) {
+                max_ring = grid->rows - 1 - row;
+        }
+
+        size_t found = 0;
+        for (size_t ring=0 ; ring<=max_ring && k>0 ; ring++) {
+                const size_t first_row = row > ring ? row - ring : 0;
+                const size_t last_row = row + ring < grid->rows ? row + ring : grid->rows - 1;
+                const size_t first_column = column > ring ? column - ring : 0;
+                const size_t last_column = column + ring < grid->columns ? column + ring : grid->columns - 1;
+                for (size_t r=first_row ; r<=last_row ; r++) {
+                        if (r + ring == row || r == row + ring) {
+                                for (size_t c=first_column ; c<=last_column ; c++) {
+                                        found = grid_scan_cell(grid, r * grid->columns + c, x, y, k, exclude, found, nodes, distances);
+                                }
+                                continue;
+                        }
+                        if (column >= ring) {
+                                found = grid_scan_cell(grid, r * grid->columns + column - ring, x, y, k, exclude, found, nodes, distances);
+                        }
+                        if (ring > 0 && column + ring < grid->columns) {
+                                found = grid_scan_cell(grid, r * grid->columns + column + ring, x, y, k, exclude, found, nodes, distances);
+                        }
+                }
+                if (found == k && distances[k - 1] <= ring * grid->cell_size) {
+                        break;
+                }
+        }
+        return found;
+}
+
+void grid_destroy(grid_t* grid) {
+        free(grid->cell_start);
+        free(grid->cell_count);
+        free(grid->cell_nodes);
+        free(grid->slots);
+        free(grid);
+}
@@ -0,0 +1,69 @@
+#include <assert.h>
+
+#include "graph.c"
+
+rng_t test_rng;
+
+void test_grid_nearest(size_t size, size_t k) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        grid_t* grid = grid_create(graph->xs, graph->ys, graph->size);
+        element_t* nodes = calloc(k, sizeof(element_t));
+        double* distances = calloc(k, sizeof(double));
+
+        for (element_t i=0 ; i<size ; i++) {
+                const size_t found = grid_nearest(grid, graph->xs[i], graph->ys[i], k, i, nodes, distances);
+                assert(found == (k < size ? k : size - 1));
+                for (size_t j=0 ; j<found ; j++) {
+                        assert(nodes[j] != i);
+                        assert(distances[j] == gra_compute_distance(graph, i, nodes[j]));
+                        assert(j == 0 || distances[j - 1] <= distances[j]);
+                }
+                size_t closer = 0;
+                for (element_t j=0 ; j<size && found>0 ; j++) {
+                        if (j != i && gra_compute_distance(graph, i, j) < distances[found - 1]) {
+                                closer++;
+                        }
+                }
+                assert(found == 0 || closer < found);
+        }
+
+        free(distances);
+        free(nodes);
+        grid_destroy(grid);
+        gra_destroy_graph(graph);
+}
+
+void test_grid_remove(size_t size) {
+        graph_t* graph = gra_generate_random_graph(size, &test_rng);
+        grid_t* grid = grid_create(graph->xs, graph->ys, graph->size);
+        char* removed = calloc(size, sizeof(char));
+
+        element_t current = 0;
+        grid_remove(grid, current);
+        removed[current] = 1;
+        for (size_t i=1 ; i<size ; i++) {
+                element_t nearest;
+                double distance;
+                assert(grid_nearest(grid, graph->xs[current], graph->ys[current], 1, current, &nearest, &distance) == 1);
+                assert(!removed[nearest]);
+                for (element_t j=0 ; j<size ; j++) {
+                        assert(removed[j] || gra_compute_distance(graph, current, j) >= distance);
+                }
+                grid_remove(grid, nearest);
+                removed[nearest] = 1;
+                current = nearest;
+        }
+        assert(grid_nearest(grid, graph->xs[current], graph->ys[current], 1, current, &current, NULL) == 0);
+
+        free(removed);
+        grid_destroy(grid);
+        gra_destroy_graph(graph);
+}
+
+int main(int argc, char** argv) {
+        rng_seed(&test_rng, 42);
+        test_grid_nearest(1, 4);
+        test_grid_nearest(5, 10);
+        test_grid_nearest(500, 10);
+        test_grid_remove(300);
+}
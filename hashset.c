@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// Open addressing set of items keyed by a 64 bit hash, safe for concurrent
+// insertion. A slot is claimed by a CAS on its key, then the item is published;
+// full comparisons only happen between items sharing the same hash.
+typedef struct {
+        size_t capacity;
+        uint64_t* keys;
+        const void** items;
+} hashset_t;
+
+typedef int (*hset_equals_t) (const void* context, const void* item1, const void* item2);
+
+hashset_t* hset_create(const size_t expected) {
+        hashset_t* set = pool_calloc(1, sizeof(hashset_t));
+        set->capacity = 16;
+        while (set->capacity < 2 * expected) {
+                set->capacity *= 2;
+        }
+        set->keys = pool_calloc(set->capacity, sizeof(uint64_t));
+        set->items = pool_calloc(set->capacity, sizeof(void*));
+        return set;
+}
+
+// Adds the item unless an equal one is already in the set. Returns the item
+// that was already there, or NULL when the item has been inserted.
+const void* hset_insert(hashset_t* set, uint64_t hash, const void* item, hset_equals_t equals, const void* context) {
+        // 0 marks an empty slot
+        hash = hash ? hash : 1;
+        const size_t mask = set->capacity - 1;
+        for (size_t probe=0 ; probe<set->capacity ; probe++) {
+                const size_t slot = (hash + probe) & mask;
+                uint64_t key = __atomic_load_n(set->keys + slot, __ATOMIC_ACQUIRE);
+                if (key == 0) {
+                        if (__atomic_compare_exchange_n(set->keys + slot, &key, hash, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                                __atomic_store_n(set->items + slot, item, __ATOMIC_RELEASE);
+                                return NULL;
+                        }
+                }
+                if (key != hash) {
+                        continue;
+                }
+                // the slot owner may not have published its item yet
+                const void* existing;
+                while ((existing = __atomic_load_n(set->items + slot, __ATOMIC_ACQUIRE)) == NULL);
+                if (equals(context, existing, item)) {
+                        return existing;
+                }
+        }
+        return item;
+}
+
+void hset_destroy(hashset_t* set) {
+        pool_free(set->keys, set->capacity * sizeof(uint64_t));
+        pool_free(set->items, set->capacity * sizeof(void*));
+        pool_free(set, sizeof(hashset_t));
+}
@@ -0,0 +1,48 @@
+#include <assert.h>
+#include <omp.h>
+
+#include "pool.c"
+#include "hashset.c"
+
+#define ITEMS 10000
+#define DISTINCT 1000
+
+int same_values(const void* context, const void* item1, const void* item2) {
+        return *(const size_t*) item1 == *(const size_t*) item2;
+}
+
+void test_insert(const uint64_t hash_mask) {
+        size_t* values = malloc(ITEMS * sizeof(size_t));
+        int* inserted = calloc(ITEMS, sizeof(int));
+        for (size_t i=0 ; i<ITEMS ; i++) {
+                values[i] = i % DISTINCT;
+        }
+
+        // a narrow hash mask forces collisions between different values
+        hashset_t* set = hset_create(DISTINCT);
+        size_t i;
+        #pragma omp parallel for
+        for (i=0 ; i<ITEMS ; i++) {
+                inserted[i] = hset_insert(set, values[i] & hash_mask, values + i, same_values, NULL) == NULL;
+        }
+
+        size_t count = 0;
+        for (size_t value=0 ; value<DISTINCT ; value++) {
+                size_t copies = 0;
+                for (size_t i=value ; i<ITEMS ; i+=DISTINCT) {
+                        copies += inserted[i];
+                }
+                assert(copies == 1);
+                count += copies;
+        }
+        assert(count == DISTINCT);
+
+        hset_destroy(set);
+        free(inserted);
+        free(values);
+}
+
+int main(int argc, char** argv) {
+        test_insert(-1);
+        test_insert(0x3f);
+}
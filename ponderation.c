@@ -7,18 +7,22 @@ typedef struct {
         size_t size;
         probability_t sum;
         probability_t* probabilities;
+        int finalized;
+        probability_t* thresholds;
+        size_t* aliases;
 } ponderation_t;
 
 ponderation_t* pond_create(size_t size) {
-        ponderation_t* ponderation = calloc(1, sizeof(ponderation_t));
+        ponderation_t* ponderation = pool_calloc(1, sizeof(ponderation_t));
         ponderation->size = size;
         ponderation->sum = 0;
-        ponderation->probabilities = calloc(size, sizeof(probability_t));
+        ponderation->probabilities = pool_calloc(size, sizeof(probability_t));
         return ponderation;
 }
 
 void ponderation_reset(ponderation_t* ponderation) {
         ponderation->sum = 0;
+        ponderation->finalized = 0;
         for (size_t i=0 ; i<ponderation->size ; i++) {
                 ponderation->probabilities[i] = 0;
         }
@@ -27,14 +31,59 @@ void ponderation_reset(ponderation_t* ponderation) {
 void pond_set_probability(ponderation_t* ponderation, const size_t index, const probability_t probability) {
         ponderation->sum += probability;
         ponderation->probabilities[index] = probability;
+        ponderation->finalized = 0;
 }
 
-probability_t random_probability() {
-        return (double) rand() / (double) RAND_MAX;
+// Builds Walker's alias table (Vose's construction) so that pond_random draws
+// in O(1). Any later pond_set_probability falls back to the linear scan.
+void pond_finalize(ponderation_t* ponderation) {
+        const size_t size = ponderation->size;
+        if (size == 0 || ponderation->sum <= 0) {
+                return;
+        }
+        if (ponderation->thresholds == NULL) {
+                ponderation->thresholds = pool_calloc(size, sizeof(probability_t));
+                ponderation->aliases = pool_calloc(size, sizeof(size_t));
+        }
+
+        size_t* worklist = pool_calloc(size, sizeof(size_t));
+        size_t small = 0;
+        size_t large = size;
+        for (size_t i=0 ; i<size ; i++) {
+                ponderation->thresholds[i] = ponderation->probabilities[i] * size / ponderation->sum;
+                ponderation->aliases[i] = i;
+                if (ponderation->thresholds[i] < 1) {
+                        worklist[small++] = i;
+                } else {
+                        worklist[--large] = i;
+                }
+        }
+        while (small > 0 && large < size) {
+                const size_t less = worklist[--small];
+                const size_t more = worklist[large];
+                ponderation->aliases[less] = more;
+                ponderation->thresholds[more] -= 1 - ponderation->thresholds[less];
+                if (ponderation->thresholds[more] < 1) {
+                        large++;
+                        worklist[small++] = more;
+                }
+        }
+        while (large < size) {
+                ponderation->thresholds[worklist[large++]] = 1;
+        }
+        while (small > 0) {
+                ponderation->thresholds[worklist[--small]] = 1;
+        }
+        pool_free(worklist, size * sizeof(size_t));
+        ponderation->finalized = 1;
 }
 
-size_t pond_random(const ponderation_t* ponderation) {
-        probability_t random = random_probability() * ponderation->sum;
+size_t pond_random(const ponderation_t* ponderation, rng_t* rng) {
+        if (ponderation->finalized) {
+                const size_t index = rng_below(rng, ponderation->size);
+                return rng_probability(rng) < ponderation->thresholds[index] ? index : ponderation->aliases[index];
+        }
+        probability_t random = rng_probability(rng) * ponderation->sum;
         for (size_t i=0 ; i<ponderation->size ; i++) {
                 if (random <= ponderation->probabilities[i]) {
                         return i;
@@ -46,6 +95,8 @@ size_t pond_random(const ponderation_t* ponderation) {
 }
 
 void pond_destroy(ponderation_t* ponderation) {
-        free(ponderation->probabilities);
-        free(ponderation);
+        pool_free(ponderation->thresholds, ponderation->size * sizeof(probability_t));
+        pool_free(ponderation->aliases, ponderation->size * sizeof(size_t));
+        pool_free(ponderation->probabilities, ponderation->size * sizeof(probability_t));
+        pool_free(ponderation, sizeof(ponderation_t));
 }
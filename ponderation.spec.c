@@ -0,0 +1,46 @@
+#include <assert.h>
+#include <math.h>
+
+#include "pool.c"
+#include "random.c"
+#include "ponderation.c"
+
+#define DRAWS 200000
+
+void test_alias_distribution(const size_t size) {
+        rng_t rng;
+        rng_seed(&rng, 42);
+        ponderation_t* ponderation = pond_create(size);
+        for (size_t i=0 ; i<size ; i++) {
+                pond_set_probability(ponderation, i, i % 3 == 1 ? 0 : 1 + i % 7);
+        }
+        pond_finalize(ponderation);
+        assert(ponderation->finalized);
+
+        size_t* counts = calloc(size, sizeof(size_t));
+        for (size_t draw=0 ; draw<DRAWS ; draw++) {
+                const size_t index = pond_random(ponderation, &rng);
+                assert(index < size);
+                counts[index]++;
+        }
+        for (size_t i=0 ; i<size ; i++) {
+                const double expected = DRAWS * ponderation->probabilities[i] / ponderation->sum;
+                if (expected == 0) {
+                        assert(counts[i] == 0);
+                } else {
+                        assert(fabs(counts[i] - expected) < 5 * sqrt(expected) + 1);
+                }
+        }
+
+        pond_set_probability(ponderation, 0, 1);
+        assert(!ponderation->finalized);
+
+        free(counts);
+        pond_destroy(ponderation);
+}
+
+int main(int argc, char** argv) {
+        test_alias_distribution(1);
+        test_alias_distribution(4);
+        test_alias_distribution(50);
+}
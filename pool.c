@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define POOL_SIZE_CLASSES 32
+#define POOL_GRANULARITY 16
+
+typedef struct pool_block {
+        struct pool_block* next;
+} pool_block_t;
+
+typedef struct {
+        size_t size;
+        pool_block_t* free_blocks;
+} pool_class_t;
+
+typedef struct {
+        size_t class_count;
+        pool_class_t classes[POOL_SIZE_CLASSES];
+} pool_t;
+
+typedef struct {
+        size_t allocations;
+        size_t frees;
+} pool_stats_t;
+
+// Every thread keeps its own free lists, one per block size, so blocks released
+// by a generation are handed back to the next one without touching malloc.
+_Thread_local pool_t pool_local;
+
+pool_stats_t pool_stats;
+
+size_t pool_block_size(const size_t size) {
+        return (size + POOL_GRANULARITY - 1) / POOL_GRANULARITY * POOL_GRANULARITY;
+}
+
+pool_class_t* pool_class(const size_t size) {
+        for (size_t i=0 ; i<pool_local.class_count ; i++) {
+                if (pool_local.classes[i].size == size) {
+                        return pool_local.classes + i;
+                }
+        }
+        if (pool_local.class_count == POOL_SIZE_CLASSES) {
+                return NULL;
+        }
+        pool_class_t* size_class = pool_local.classes + pool_local.class_count++;
+        size_class->size = size;
+        size_class->free_blocks = NULL;
+        return size_class;
+}
+
+void* pool_alloc(const size_t size) {
+        const size_t block_size = pool_block_size(size > 0 ? size : 1);
+        pool_class_t* size_class = pool_class(block_size);
+        if (size_class != NULL && size_class->free_blocks != NULL) {
+                pool_block_t* block = size_class->free_blocks;
+                size_class->free_blocks = block->next;
+                return block;
+        }
+        __atomic_fetch_add(&pool_stats.allocations, 1, __ATOMIC_RELAXED);
+        return malloc(block_size);
+}
+
+void* pool_calloc(const size_t count, const size_t size) {
+        void* memory = pool_alloc(count * size);
+        memset(memory, 0, count * size);
+        return memory;
+}
+
+void pool_free(void* memory, const size_t size) {
+        if (memory == NULL) {
+                return;
+        }
+        pool_class_t* size_class = pool_class(pool_block_size(size > 0 ? size : 1));
+        if (size_class == NULL) {
+                __atomic_fetch_add(&pool_stats.frees, 1, __ATOMIC_RELAXED);
+                free(memory);
+                return;
+        }
+        pool_block_t* block = memory;
+        block->next = size_class->free_blocks;
+        size_class->free_blocks = block;
+}
+
+// Gives the blocks cached by the calling thread back to the system.
+void pool_release() {
+        for (size_t i=0 ; i<pool_local.class_count ; i++) {
+                pool_block_t* block = pool_local.classes[i].free_blocks;
+                while (block != NULL) {
+                        pool_block_t* next = block->next;
+                        free(block);
+                        __atomic_fetch_add(&pool_stats.frees, 1, __ATOMIC_RELAXED);
+                        block = next;
+                }
+                pool_local.classes[i].free_blocks = NULL;
+        }
+        pool_local.class_count = 0;
+}
+
+pool_stats_t pool_get_stats() {
+        pool_stats_t stats;
+        stats.allocations = __atomic_load_n(&pool_stats.allocations, __ATOMIC_RELAXED);
+        stats.frees = __atomic_load_n(&pool_stats.frees, __ATOMIC_RELAXED);
+        return stats;
+}
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+// xoshiro256** generator. Every stream is seeded through splitmix64 from a
+// (seed, stream, index) triple, so a given seed always produces the same
+// numbers for the same piece of work, whichever thread runs it.
+typedef struct {
+        uint64_t state[4];
+} rng_t;
+
+uint64_t rng_mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+}
+
+uint64_t rng_splitmix(uint64_t* x) {
+        *x += 0x9e3779b97f4a7c15ULL;
+        return rng_mix(*x);
+}
+
+void rng_seed(rng_t* rng, uint64_t seed) {
+        for (size_t i=0 ; i<4 ; i++) {
+                rng->state[i] = rng_splitmix(&seed);
+        }
+}
+
+rng_t rng_derive(const uint64_t seed, const uint64_t stream, const uint64_t index) {
+        rng_t rng;
+        rng_seed(&rng, rng_mix(rng_mix(seed ^ rng_mix(stream + 1)) ^ index));
+        return rng;
+}
+
+uint64_t rng_rotate(const uint64_t x, const int k) {
+        return (x << k) | (x >> (64 - k));
+}
+
+uint64_t rng_next(rng_t* rng) {
+        uint64_t* s = rng->state;
+        const uint64_t result = rng_rotate(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rng_rotate(s[3], 45);
+        return result;
+}
+
+double rng_probability(rng_t* rng) {
+        return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+size_t rng_below(rng_t* rng, const size_t bound) {
+        return ((unsigned __int128) rng_next(rng) * bound) >> 64;
+}
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define TRANSPORT_BUFFER_SIZE (4 * 1024 * 1024)
+
+// Best effort message passing between the count processes of a run, each one
+// identified by its rank. Sends never block: a message that cannot be queued
+// is dropped and counted in failed, which is fine for migrants.
+typedef struct transport {
+        size_t rank;
+        size_t count;
+        size_t sent;
+        size_t failed;
+        size_t received;
+        void* state;
+        int (*send) (struct transport*, size_t destination, const void* message, size_t size);
+        ssize_t (*receive) (struct transport*, void* buffer, size_t capacity);
+        void (*release) (struct transport*);
+        void (*destroy) (struct transport*);
+} transport_t;
+
+int transport_send(transport_t* transport, const size_t destination, const void* message, const size_t size) {
+        if (transport->send(transport, destination, message, size) != 0) {
+                transport->failed++;
+                return -1;
+        }
+        transport->sent++;
+        return 0;
+}
+
+// Returns the size of the next pending message, or -1 when there is none.
+ssize_t transport_receive(transport_t* transport, void* buffer, const size_t capacity) {
+        const ssize_t size = transport->receive(transport, buffer, capacity);
+        if (size >= 0) {
+                transport->received++;
+        }
+        return size;
+}
+
+// Frees a transport inherited through fork() without giving up its address,
+// which still belongs to the process that created it.
+void transport_release(transport_t* transport) {
+        transport->release(transport);
+}
+
+void transport_destroy(transport_t* transport) {
+        transport->destroy(transport);
+}
+
+// Unix domain datagram sockets, bound to <prefix>.<rank>. Messages are split
+// in fragments of at most TRANSPORT_FRAGMENT_SIZE bytes, well under the
+// datagram size the system allows, and put back together by the receiver.
+// A message with a lost fragment is dropped as a whole.
+#define TRANSPORT_FRAGMENT_SIZE (64 * 1024)
+
+typedef struct {
+        uint32_t source;
+        uint32_t sequence;
+        uint64_t offset;
+        uint64_t size;
+} transport_fragment_t;
+
+// Message being received from one source.
+typedef struct {
+        uint32_t sequence;
+        int broken;
+        size_t size;
+        size_t received;
+        size_t capacity;
+        unsigned char* buffer;
+} transport_assembly_t;
+
+typedef struct {
+        int socket;
+        char prefix[64];
+        uint32_t sequence;
+        unsigned char* packet;
+        transport_assembly_t* assemblies;
+} transport_unix_t;
+
+void transport_unix_address(const transport_unix_t* state, const size_t rank, struct sockaddr_un* address) {
+        memset(address, 0, sizeof(struct sockaddr_un));
+        address->sun_family = AF_UNIX;
+        snprintf(address->sun_path, sizeof(address->sun_path), "%s.%zu", state->prefix, rank);
+}
+
+int transport_unix_send(transport_t* transport, const size_t destination, const void* message, const size_t size) {
+        transport_unix_t* state = transport->state;
+        struct sockaddr_un address;
+        transport_unix_address(state, destination, &address);
+
+        transport_fragment_t fragment = { transport->rank, state->sequence++, 0, size };
+        do {
+                const size_t length = size - fragment.offset < TRANSPORT_FRAGMENT_SIZE ? size - fragment.offset : TRANSPORT_FRAGMENT_SIZE;
+                memcpy(state->packet, &fragment, sizeof(fragment));
+                memcpy(state->packet + sizeof(fragment), (const unsigned char*) message + fragment.offset, length);
+                const ssize_t sent = sendto(state->socket, state->packet, sizeof(fragment) + length, MSG_DONTWAIT, (struct sockaddr*) &address, sizeof(address));
+                if (sent != (ssize_t) (sizeof(fragment) + length)) {
+                        return -1;
+                }
+                fragment.offset += length;
+        } while (fragment.offset < size);
+        return 0;
+}
+
+ssize_t transport_unix_receive(transport_t* transport, void* buffer, const size_t capacity) {
+        const transport_unix_t* state = transport->state;
+        while (1) {
+                const ssize_t length = recv(state->socket, state->packet, sizeof(transport_fragment_t) + TRANSPORT_FRAGMENT_SIZE, MSG_DONTWAIT);
+                if (length < 0) {
+                        return -1;
+                }
+                transport_fragment_t fragment;
+                if ((size_t) length < sizeof(fragment)) {
+                        continue;
+                }
+                memcpy(&fragment, state->packet, sizeof(fragment));
+                const size_t payload = length - sizeof(fragment);
+                if (fragment.source >= transport->count || fragment.offset + payload > fragment.size) {
+                        continue;
+                }
+
+                transport_assembly_t* assembly = state->assemblies + fragment.source;
+                if (fragment.offset == 0) {
+                        assembly->sequence = fragment.sequence;
+                        assembly->broken = 0;
+                        assembly->size = fragment.size;
+                        assembly->received = 0;
+                        if (assembly->capacity < fragment.size) {
+                                free(assembly->buffer);
+                                assembly->buffer = malloc(fragment.size);
+                                assembly->capacity = fragment.size;
+                        }
+                } else if (assembly->sequence != fragment.sequence || assembly->received != fragment.offset) {
+                        assembly->broken = 1;
+                }
+                if (assembly->broken) {
+                        continue;
+                }
+                memcpy(assembly->buffer + fragment.offset, state->packet + sizeof(fragment), payload);
+                assembly->received += payload;
+                if (assembly->received < assembly->size) {
+                        continue;
+                }
+                assembly->broken = 1;
+                if (assembly->size > capacity) {
+                        continue;
+                }
+                memcpy(buffer, assembly->buffer, assembly->size);
+                return assembly->size;
+        }
+}
+
+void transport_unix_release(transport_t* transport) {
+        transport_unix_t* state = transport->state;
+        close(state->socket);
+        for (size_t i=0 ; i<transport->count ; i++) {
+                free(state->assemblies[i].buffer);
+        }
+        free(state->assemblies);
+        free(state->packet);
+        free(state);
+        free(transport);
+}
+
+void transport_unix_destroy(transport_t* transport) {
+        struct sockaddr_un address;
+        transport_unix_address(transport->state, transport->rank, &address);
+        unlink(address.sun_path);
+        transport_unix_release(transport);
+}
+
+transport_t* transport_unix_create(const char* prefix, const size_t rank, const size_t count) {
+        transport_unix_t* state = calloc(1, sizeof(transport_unix_t));
+        snprintf(state->prefix, sizeof(state->prefix), "%s", prefix);
+        state->socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (state->socket < 0) {
+                perror("socket");
+                free(state);
+                return NULL;
+        }
+        const int buffer_size = TRANSPORT_BUFFER_SIZE;
+        setsockopt(state->socket, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+        setsockopt(state->socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+        struct sockaddr_un address;
+        transport_unix_address(state, rank, &address);
+        unlink(address.sun_path);
+        if (bind(state->socket, (struct sockaddr*) &address, sizeof(address)) != 0) {
+                perror("bind");
+                close(state->socket);
+                free(state);
+                return NULL;
+        }
+
+        state->packet = malloc(sizeof(transport_fragment_t) + TRANSPORT_FRAGMENT_SIZE);
+        state->assemblies = calloc(count, sizeof(transport_assembly_t));
+
+        transport_t* transport = calloc(1, sizeof(transport_t));
+        transport->rank = rank;
+        transport->count = count;
+        transport->state = state;
+        transport->send = transport_unix_send;
+        transport->receive = transport_unix_receive;
+        transport->release = transport_unix_release;
+        transport->destroy = transport_unix_destroy;
+        return transport;
+}
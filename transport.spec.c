@@ -0,0 +1,191 @@
+#include <assert.h>
+#include <sys/wait.h>
+
+#include "tsp.c"
+
+#define TEST_GRAPH_SIZE 100
+#define TEST_PROCESSES 3
+
+char test_prefix[64];
+
+graph_t* test_graph() {
+        rng_t rng = rng_derive(42, -1, 0);
+        graph_t* graph = gra_generate_random_graph(TEST_GRAPH_SIZE, &rng);
+        gra_build_neighbor_lists(graph, GRA_NEIGHBOR_COUNT);
+        return graph;
+}
+
+ga_parameters_t test_parameters(graph_t* graph, transport_t* transport) {
+        ga_parameters_t parameters = tsp_parameters(graph, 42);
+        parameters.population_size = 30;
+        parameters.verbose = 0;
+        parameters.migration_interval = 2;
+        parameters.migrant_count = 3;
+        parameters.transport = transport;
+        return parameters;
+}
+
+void test_serialization() {
+        graph_t* graph = test_graph();
+        rng_t rng = rng_derive(42, 0, 0);
+        path_t* path = tsp_generate_random_path(graph, &rng);
+        const size_t size = tsp_serialize_path(graph, path, NULL);
+        assert(size == (TEST_GRAPH_SIZE + 1) * sizeof(uint32_t));
+
+        uint32_t* buffer = malloc(size);
+        assert(tsp_serialize_path(graph, path, buffer) == size);
+        path_t* copy = tsp_deserialize_path(graph, buffer, size);
+        assert(copy != NULL && path_cmp(path, copy) == 0);
+        path_destroy(copy);
+
+        assert(tsp_deserialize_path(graph, buffer, size - sizeof(uint32_t)) == NULL);
+        buffer[2] = buffer[1];
+        assert(tsp_deserialize_path(graph, buffer, size) == NULL);
+
+        free(buffer);
+        path_destroy(path);
+        gra_destroy_graph(graph);
+}
+
+void test_transport() {
+        transport_t* transport0 = transport_unix_create(test_prefix, 0, 2);
+        transport_t* transport1 = transport_unix_create(test_prefix, 1, 2);
+        char buffer[16];
+        assert(transport_receive(transport1, buffer, sizeof(buffer)) == -1);
+        assert(transport_send(transport0, 1, "migrant", 8) == 0);
+        assert(transport_receive(transport1, buffer, sizeof(buffer)) == 8);
+        assert(strcmp(buffer, "migrant") == 0);
+        assert(transport0->sent == 1 && transport1->received == 1);
+        transport_destroy(transport0);
+        transport_destroy(transport1);
+}
+
+// Messages larger than a fragment are reassembled. One that cannot be queued
+// entirely is counted as failed and never delivered in part.
+void test_large_messages() {
+        transport_t* transport0 = transport_unix_create(test_prefix, 0, 2);
+        transport_t* transport1 = transport_unix_create(test_prefix, 1, 2);
+        const size_t size = 5 * TRANSPORT_FRAGMENT_SIZE - 3;
+        unsigned char* message = malloc(64 * TRANSPORT_FRAGMENT_SIZE);
+        unsigned char* buffer = malloc(64 * TRANSPORT_FRAGMENT_SIZE);
+        for (size_t i=0 ; i<size ; i++) {
+                message[i] = i * 7;
+        }
+        assert(transport_send(transport0, 1, message, size) == 0);
+        assert(transport_receive(transport1, buffer, size - 1) == -1);
+        assert(transport_send(transport0, 1, message, size) == 0);
+        assert(transport_receive(transport1, buffer, size) == (ssize_t) size);
+        assert(memcmp(message, buffer, size) == 0);
+
+        // more fragments than the receiving queue usually holds
+        const int sent = transport_send(transport0, 1, message, 64 * TRANSPORT_FRAGMENT_SIZE);
+        assert(sent == 0 ? transport0->sent == 3 : transport0->failed == 1);
+        assert(transport_receive(transport1, buffer, 64 * TRANSPORT_FRAGMENT_SIZE) == (sent == 0 ? 64 * TRANSPORT_FRAGMENT_SIZE : -1));
+        assert(transport_send(transport0, 1, "migrant", 8) == 0);
+        assert(transport_receive(transport1, buffer, 64 * TRANSPORT_FRAGMENT_SIZE) == 8);
+
+        free(buffer);
+        free(message);
+        transport_destroy(transport0);
+        transport_destroy(transport1);
+}
+
+// A process with an evolved population sends its best individuals to one
+// with a random population, which must adopt them.
+void test_migration_progress() {
+        transport_t* receiver = transport_unix_create(test_prefix, 0, 2);
+        const pid_t child = fork();
+        if (child == 0) {
+                transport_release(receiver);
+                graph_t* graph = test_graph();
+                transport_t* sender = transport_unix_create(test_prefix, 1, 2);
+                ga_parameters_t parameters = test_parameters(graph, sender);
+                parameters.transport = NULL;
+                parameters.max_generations = 20;
+                path_t* best = ga_fit(&parameters);
+
+                population_t* population = ga_generate_empty_population(parameters.population_size);
+                for (size_t i=0 ; i<population->size ; i++) {
+                        rng_t rng = rng_derive(42, 1, i);
+                        population->individuals[i] = pool_calloc(1, sizeof(individual_t));
+                        population->individuals[i]->references = 1;
+                        population->individuals[i]->score = -1;
+                        population->individuals[i]->solution = i == 0 ? best : tsp_generate_random_path(graph, &rng);
+                        ga_regularize_individual(&parameters, population->individuals[i]);
+                        ga_evaluate_individual_score(&parameters, population->individuals[i]);
+                }
+                ga_evaluate_population(&parameters, population);
+                parameters.transport = sender;
+                ga_send_migrants(&parameters, population, 0);
+                const int status = sender->sent == parameters.migrant_count && sender->failed == 0 ? 0 : 1;
+                ga_destroy_population(&parameters, population);
+                transport_destroy(sender);
+                gra_destroy_graph(graph);
+                exit(status);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        graph_t* graph = test_graph();
+        ga_parameters_t parameters = test_parameters(graph, receiver);
+        population_t* population = ga_generate_random_population(&parameters);
+        ga_evaluate_population(&parameters, population);
+        const score_t initial_best = population->individuals[0]->score;
+
+        assert(ga_receive_migrants(&parameters, population) == parameters.migrant_count);
+        ga_evaluate_population(&parameters, population);
+        assert(population->individuals[0]->score < initial_best);
+        assert(receiver->received == parameters.migrant_count);
+
+        ga_destroy_population(&parameters, population);
+        transport_destroy(receiver);
+        gra_destroy_graph(graph);
+}
+
+// Several processes run ga_fit as islands of one run, and must all hear from
+// the others. Sockets are bound before forking so that no migrant is lost to
+// a process which has not started yet.
+void test_processes() {
+        transport_t* transports[TEST_PROCESSES];
+        pid_t children[TEST_PROCESSES];
+        for (size_t rank=0 ; rank<TEST_PROCESSES ; rank++) {
+                transports[rank] = transport_unix_create(test_prefix, rank, TEST_PROCESSES);
+        }
+        for (size_t rank=0 ; rank<TEST_PROCESSES ; rank++) {
+                children[rank] = fork();
+                if (children[rank] == 0) {
+                        for (size_t other=0 ; other<TEST_PROCESSES ; other++) {
+                                if (other != rank) {
+                                        transport_release(transports[other]);
+                                }
+                        }
+                        graph_t* graph = test_graph();
+                        transport_t* transport = transports[rank];
+                        ga_parameters_t parameters = test_parameters(graph, transport);
+                        parameters.max_generations = 200;
+                        path_t* solution = ga_fit(&parameters);
+                        const int status = transport->sent > 0 && transport->received > 0 ? 0 : 1;
+                        path_destroy(solution);
+                        transport_destroy(transport);
+                        gra_destroy_graph(graph);
+                        exit(status);
+                }
+        }
+        for (size_t rank=0 ; rank<TEST_PROCESSES ; rank++) {
+                int status;
+                waitpid(children[rank], &status, 0);
+                assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+                transport_destroy(transports[rank]);
+        }
+}
+
+int main(int argc, char** argv) {
+        snprintf(test_prefix, sizeof(test_prefix), "/tmp/ga-transport-%d", getpid());
+        // processes are forked before the parent starts any OpenMP thread
+        test_processes();
+        test_migration_progress();
+        test_transport();
+        test_large_messages();
+        test_serialization();
+}
@@ -0,0 +1,435 @@
+#include "ga.c"
+
+path_t* tsp_generate_random_path(const graph_t* graph, rng_t* rng) {
+        path_t* path = path_generate_simple(graph);
+        path_randomize(graph, path, rng);
+        return path;
+}
+
+path_t* tsp_generate_greedy_path(const graph_t* graph, rng_t* rng) {
+        grid_t* unvisited_nodes = grid_create(graph->xs, graph->ys, graph->size);
+        path_t* path = path_generate_empty(graph->size);
+
+        element_t current = rng_below(rng, graph->size);
+        path->node_indices[0] = current;
+        grid_remove(unvisited_nodes, current);
+        for (size_t i=1 ; i<graph->size ; i++) {
+                distance_t closest_distance;
+                grid_nearest(unvisited_nodes, graph->xs[current], graph->ys[current], 1, current, &current, &closest_distance);
+                grid_remove(unvisited_nodes, current);
+                path->node_indices[i] = current;
+        }
+        path_index_positions(path);
+
+        grid_destroy(unvisited_nodes);
+
+        return path;
+}
+
+void tsp_regularize_path(const graph_t* graph, path_t* solution) {
+        const size_t start = path_node_position(solution, 0);
+        path_rotate(solution, start, path_previous(solution, start) < path_next(solution, start));
+        if (solution->neighborhood == NULL) {
+                solution->neighborhood = neighborhood_from_path(graph, solution);
+        }
+}
+
+int tsp_compare_solutions(const graph_t* graph, const path_t* path1, const path_t* path2) {
+        return path_cmp(path1, path2);
+}
+
+uint64_t tsp_hash_path(const graph_t* graph, const path_t* path) {
+        return path_hash(path);
+}
+
+path_t* tsp_copy_path(const graph_t* graph, const path_t* path) {
+        return path_copy(path);
+}
+
+score_t tsp_score(const graph_t* graph, const path_t* path) {
+        return path_length(graph, path);
+}
+
+element_t tsp_node_from_neighbors(const ponderation_t* ponderation, const element_t node, const path_t* path1, const path_t* path2, rng_t* rng) {
+        size_t chosen_one = pond_random(ponderation, rng);
+        if (chosen_one < 2) {
+                return neighborhood_neighbor(path1->neighborhood, node, chosen_one);
+        } else {
+                return neighborhood_neighbor(path2->neighborhood, node, chosen_one - 2);
+        }
+}
+
+element_t tsp_first_unvisited_node(const ensemble_t* ensemble, const element_t from) {
+        return ens_first_missing(ensemble, from);
+}
+
+void tsp_ponderation_from_neighborhoods(ponderation_t* ponderation, const graph_t* graph, const ensemble_t* ensemble, const element_t node, const path_t* path1, const path_t* path2) {
+        ponderation_reset(ponderation);
+
+        for (size_t i = 0 ; i<2 ; i++) {
+                const element_t neighbor = neighborhood_neighbor(path1->neighborhood, node, i);
+                if (ens_contains(ensemble, neighbor)) {
+                        pond_set_probability(ponderation, i, 0);
+                } else {
+                        pond_set_probability(ponderation, i, 1 / gra_distance_between_nodes(graph, node, neighbor));
+                }
+        }
+
+        for (size_t i = 0 ; i<2 ; i++) {
+                const element_t neighbor = neighborhood_neighbor(path2->neighborhood, node, i);
+                if (ens_contains(ensemble, neighbor)) {
+                        pond_set_probability(ponderation, i + 2, 0);
+                } else {
+                        pond_set_probability(ponderation, i + 2, 1 / gra_distance_between_nodes(graph, node, neighbor));
+                }
+        }
+}
+
+// Mutations apply at most TWO_OPT_ITERATIONS improving moves, whether or not
+// neighbor lists speed up the search, rather than reaching a local optimum.
+#define TWO_OPT_ITERATIONS 100
+
+void tsp_path_mutate_2_opt(const graph_t* graph, path_t* path, rng_t* rng) {
+        const size_t starting_node = rng_below(rng, path->size);
+        if (graph->neighbor_lists != NULL) {
+                path_local_search(graph, path, path_2_opt_neighbors_node, starting_node, path->size, TWO_OPT_ITERATIONS);
+                return;
+        }
+        for (size_t i=0 ; i<TWO_OPT_ITERATIONS ; i++) {
+                path_2_opt_from_to(graph, path, starting_node, path->size);
+        }
+}
+
+void tsp_path_mutate_or_opt(const graph_t* graph, path_t* path, rng_t* rng) {
+        path_local_search(graph, path, path_or_opt_node, rng_below(rng, path->size), path->size, TWO_OPT_ITERATIONS);
+}
+
+void tsp_path_mutate_lk_opt(const graph_t* graph, path_t* path, rng_t* rng) {
+        path_local_search(graph, path, path_lk_node, rng_below(rng, path->size), path->size, TWO_OPT_ITERATIONS);
+}
+
+// Runs 2-opt to a local optimum, much slower than the bounded mutation.
+void tsp_path_local_search_2_opt(const graph_t* graph, path_t* path, rng_t* rng) {
+        path_2_opt_neighbors(graph, path, rng_below(rng, path->size), path->size);
+}
+
+// Scratch state reused by every crossover a thread performs, so building a
+// child only allocates the child itself.
+typedef struct {
+        size_t size;
+        ensemble_t* visited;
+        ponderation_t* ponderation;
+        // partition crossover
+        element_t* components;
+        element_t* stack;
+        size_t* portals;
+        distance_t* lengths;
+} tsp_workspace_t;
+
+tsp_workspace_t* tsp_workspace_create(const size_t size) {
+        tsp_workspace_t* workspace = calloc(1, sizeof(tsp_workspace_t));
+        workspace->size = size;
+        workspace->visited = ens_create(size);
+        workspace->ponderation = pond_create(4);
+        workspace->components = calloc(size, sizeof(element_t));
+        workspace->stack = calloc(size, sizeof(element_t));
+        workspace->portals = calloc(size, sizeof(size_t));
+        workspace->lengths = calloc(2 * size, sizeof(distance_t));
+        return workspace;
+}
+
+void tsp_workspace_destroy(tsp_workspace_t* workspace) {
+        free(workspace->lengths);
+        free(workspace->portals);
+        free(workspace->stack);
+        free(workspace->components);
+        pond_destroy(workspace->ponderation);
+        ens_destroy(workspace->visited);
+        free(workspace);
+}
+
+_Thread_local tsp_workspace_t* tsp_thread_workspace;
+
+// Workspace of the calling thread, kept for the lifetime of the thread.
+tsp_workspace_t* tsp_workspace_of_thread(const graph_t* graph) {
+        if (tsp_thread_workspace != NULL && tsp_thread_workspace->size != graph->size) {
+                tsp_workspace_destroy(tsp_thread_workspace);
+                tsp_thread_workspace = NULL;
+        }
+        if (tsp_thread_workspace == NULL) {
+                tsp_thread_workspace = tsp_workspace_create(graph->size);
+        }
+        return tsp_thread_workspace;
+}
+
+// Writes the child into crossed, which must hold graph->size nodes.
+void tsp_cross_neighbors_into(const graph_t* graph, const path_t* path1, const path_t* path2, path_t* crossed, tsp_workspace_t* workspace, rng_t* rng) {
+        ponderation_t* ponderation = workspace->ponderation;
+        ensemble_t* ensemble = workspace->visited;
+        ens_clear(ensemble);
+
+        element_t unvisited_from = 0;
+        element_t current = rng_below(rng, graph->size);
+
+        *(crossed->node_indices) = current;
+        ens_add_element(ensemble, current);
+
+        for (size_t i = 1 ; i<crossed->size ; i++) {
+                tsp_ponderation_from_neighborhoods(ponderation, graph, ensemble, current, path1, path2);
+
+                if (ponderation->sum==0) {
+                        current = tsp_first_unvisited_node(ensemble, unvisited_from);
+                        unvisited_from = current;
+                } else {
+                        current = tsp_node_from_neighbors(ponderation, current, path1, path2, rng);
+                }
+
+                *(crossed->node_indices + i) = current;
+                ens_add_element(ensemble, current);
+
+        }
+
+        path_index_positions(crossed);
+        tsp_path_mutate_2_opt(graph, crossed, rng);
+}
+
+path_t* tsp_cross_paths_neighbors(const graph_t* graph, const path_t* path1, const path_t* path2, rng_t* rng) {
+        path_t* crossed = path_generate_empty(graph->size);
+        tsp_cross_neighbors_into(graph, path1, path2, crossed, tsp_workspace_of_thread(graph), rng);
+        return crossed;
+}
+
+#define TSP_NO_COMPONENT ((element_t) -1)
+
+int tsp_has_edge(const neighborhood_t* neighborhood, const element_t a, const element_t b) {
+        return neighborhood_neighbor(neighborhood, a, 0) == b || neighborhood_neighbor(neighborhood, a, 1) == b;
+}
+
+// Labels the components of the graph made of the edges that belong to only
+// one parent, and returns their count. Nodes whose edges are all shared get
+// TSP_NO_COMPONENT.
+size_t tsp_partition_components(const path_t* path1, const path_t* path2, tsp_workspace_t* workspace) {
+        const neighborhood_t* neighborhoods[2] = { path1->neighborhood, path2->neighborhood };
+        element_t* components = workspace->components;
+        element_t* stack = workspace->stack;
+        const size_t size = workspace->size;
+        for (size_t i=0 ; i<size ; i++) {
+                components[i] = TSP_NO_COMPONENT;
+        }
+
+        size_t count = 0;
+        for (element_t node=0 ; node<size ; node++) {
+                if (components[node] != TSP_NO_COMPONENT || (tsp_has_edge(path2->neighborhood, node, neighborhood_neighbor(path1->neighborhood, node, 0))
+                                && tsp_has_edge(path2->neighborhood, node, neighborhood_neighbor(path1->neighborhood, node, 1)))) {
+                        continue;
+                }
+                size_t top = 0;
+                stack[top++] = node;
+                components[node] = count;
+                while (top > 0) {
+                        const element_t current = stack[--top];
+                        for (size_t p=0 ; p<2 ; p++) {
+                                for (size_t i=0 ; i<2 ; i++) {
+                                        const element_t neighbor = neighborhood_neighbor(neighborhoods[p], current, i);
+                                        if (components[neighbor] == TSP_NO_COMPONENT && !tsp_has_edge(neighborhoods[1 - p], current, neighbor)) {
+                                                components[neighbor] = count;
+                                                stack[top++] = neighbor;
+                                        }
+                                }
+                        }
+                }
+                count++;
+        }
+        return count;
+}
+
+// Generalized partition crossover: the edges found in only one parent split
+// the tour into components. A component entered by exactly two shared edges
+// is walked as a single segment by both parents, so either parent's segment
+// can be kept independently of the other components. The child takes the
+// shorter parent, then swaps in every such segment that the other parent
+// covers more cheaply. Returns 0, leaving crossed untouched, when no segment
+// can be swapped.
+int tsp_cross_partition_into(const graph_t* graph, const path_t* path1, const path_t* path2, path_t* crossed, tsp_workspace_t* workspace) {
+        if (path1->neighborhood->length > path2->neighborhood->length) {
+                const path_t* shorter = path2;
+                path2 = path1;
+                path1 = shorter;
+        }
+        const size_t count = tsp_partition_components(path1, path2, workspace);
+        if (count < 2) {
+                return 0;
+        }
+
+        const neighborhood_t* neighborhoods[2] = { path1->neighborhood, path2->neighborhood };
+        const element_t* components = workspace->components;
+        size_t* portals = workspace->portals;
+        distance_t* lengths = workspace->lengths;
+        for (size_t c=0 ; c<count ; c++) {
+                portals[c] = 0;
+                lengths[2 * c] = 0;
+                lengths[2 * c + 1] = 0;
+        }
+        for (element_t node=0 ; node<graph->size ; node++) {
+                const element_t component = components[node];
+                if (component == TSP_NO_COMPONENT) {
+                        continue;
+                }
+                for (size_t p=0 ; p<2 ; p++) {
+                        for (size_t i=0 ; i<2 ; i++) {
+                                const element_t neighbor = neighborhood_neighbor(neighborhoods[p], node, i);
+                                if (!tsp_has_edge(neighborhoods[1 - p], node, neighbor)) {
+                                        lengths[2 * component + p] += gra_distance_between_nodes(graph, node, neighbor) / 2;
+                                } else if (p == 0 && components[neighbor] != component) {
+                                        portals[component]++;
+                                }
+                        }
+                }
+        }
+
+        size_t swapped = 0;
+        for (size_t c=0 ; c<count ; c++) {
+                // portals now flags the components taken from the longer parent
+                portals[c] = portals[c] == 2 && lengths[2 * c + 1] < lengths[2 * c];
+                swapped += portals[c];
+        }
+        if (swapped == 0) {
+                return 0;
+        }
+
+        element_t previous = 0;
+        element_t current = 0;
+        for (size_t i=0 ; i<crossed->size ; i++) {
+                crossed->node_indices[i] = current;
+                const neighborhood_t* neighborhood = neighborhoods[components[current] != TSP_NO_COMPONENT && portals[components[current]]];
+                const element_t next = neighborhood_neighbor(neighborhood, current, 0);
+                const element_t other = neighborhood_neighbor(neighborhood, current, 1);
+                const element_t following = i == 0 || next != previous ? next : other;
+                previous = current;
+                current = following;
+        }
+        path_index_positions(crossed);
+        return 1;
+}
+
+// Falls back on the neighbor recombination when the parents share no
+// swappable segment.
+path_t* tsp_cross_paths_partition(const graph_t* graph, const path_t* path1, const path_t* path2, rng_t* rng) {
+        path_t* crossed = path_generate_empty(graph->size);
+        tsp_workspace_t* workspace = tsp_workspace_of_thread(graph);
+        if (tsp_cross_partition_into(graph, path1, path2, crossed, workspace)) {
+                tsp_path_mutate_2_opt(graph, crossed, rng);
+        } else {
+                tsp_cross_neighbors_into(graph, path1, path2, crossed, workspace, rng);
+        }
+        return crossed;
+}
+
+// Appends to crossed up to count nodes of path, read from position from on,
+// that are not visited yet, and returns the new length of crossed.
+size_t tsp_append_unvisited(const path_t* path, path_t* crossed, size_t length, ensemble_t* visited, const size_t from, const size_t count) {
+        const size_t end = length + count;
+        for (size_t i=0 ; i<path->size && length<end ; i++) {
+                const element_t current = path->node_indices[(i + from) % path->size];
+                if (!ens_contains(visited, current)) {
+                        ens_add_element(visited, current);
+                        crossed->node_indices[length++] = current;
+                }
+        }
+        return length;
+}
+
+void tsp_cross_naive_cut_into(const graph_t* graph, const path_t* path1, const path_t* path2, path_t* crossed, tsp_workspace_t* workspace, rng_t* rng) {
+        const size_t cut1 = rng_below(rng, path1->size - 2);
+        const size_t cut2 = cut1 + 1 + rng_below(rng, path1->size - cut1);
+
+        ensemble_t* visited = workspace->visited;
+        ens_clear(visited);
+
+        size_t length = tsp_append_unvisited(path1, crossed, 0, visited, 0, cut1);
+        length = tsp_append_unvisited(path2, crossed, length, visited, cut1, cut2 - cut1);
+        tsp_append_unvisited(path1, crossed, length, visited, cut2, path1->size - cut2);
+        path_index_positions(crossed);
+}
+
+path_t* tsp_cross_paths_naive_cut(const graph_t* graph, const path_t* path1, const path_t* path2, rng_t* rng) {
+        path_t* crossed = path_generate_empty(graph->size);
+        tsp_cross_naive_cut_into(graph, path1, path2, crossed, tsp_workspace_of_thread(graph), rng);
+        return crossed;
+}
+
+void tsp_path_mutate_random_swap(const graph_t* graph, path_t* solution, rng_t* rng){
+        const size_t swap1 = rng_below(rng, solution->size);
+        const size_t swap2 = rng_below(rng, solution->size);
+
+        path_exchange_nodes(graph, solution, swap1, swap2);
+}
+
+// A path is sent as its uint32 node count followed by its uint32 node indices.
+size_t tsp_serialize_path(const graph_t* graph, const path_t* path, void* buffer) {
+        if (buffer != NULL) {
+                uint32_t* words = buffer;
+                words[0] = path->size;
+                for (size_t i=0 ; i<path->size ; i++) {
+                        words[i + 1] = path->node_indices[i];
+                }
+        }
+        return (path->size + 1) * sizeof(uint32_t);
+}
+
+path_t* tsp_deserialize_path(const graph_t* graph, const void* buffer, const size_t size) {
+        const uint32_t* words = buffer;
+        if (size < sizeof(uint32_t) || words[0] != graph->size || size != (graph->size + 1) * sizeof(uint32_t)) {
+                return NULL;
+        }
+        path_t* path = path_generate_empty(graph->size);
+        ensemble_t* visited = ens_create(graph->size);
+        for (size_t i=0 ; i<graph->size ; i++) {
+                const uint32_t node = words[i + 1];
+                if (node >= graph->size || ens_contains(visited, node)) {
+                        ens_destroy(visited);
+                        path_destroy(path);
+                        return NULL;
+                }
+                ens_add_element(visited, node);
+                path->node_indices[i] = node;
+        }
+        ens_destroy(visited);
+        path_index_positions(path);
+        return path;
+}
+
+ga_parameters_t tsp_parameters(graph_t* graph, const uint64_t seed) {
+        ga_parameters_t parameters;
+        parameters.graph = graph;
+        parameters.elitism = 1;
+        parameters.mutation_rate = 0.02;
+        parameters.survival_rate = 0.2;
+        parameters.population_size = 200;
+        parameters.seed = seed;
+        parameters.selection = GA_SELECTION_ROULETTE;
+        parameters.tournament_size = 3;
+        parameters.selection_pressure = 1.5;
+        parameters.target_score = 0;
+        parameters.max_generations = 0;
+        parameters.verbose = 1;
+        parameters.island_count = 1;
+        parameters.migration_interval = 10;
+        parameters.migrant_count = 2;
+        parameters.migration = GA_MIGRATION_RING;
+        parameters.transport = NULL;
+        parameters.steady_state = 0;
+
+        parameters.generate = tsp_generate_random_path;
+        parameters.regularize = tsp_regularize_path;
+        parameters.compare = tsp_compare_solutions;
+        parameters.hash = tsp_hash_path;
+        parameters.evaluate = tsp_score;
+        parameters.copy = tsp_copy_path;
+        parameters.cross = tsp_cross_paths_partition;
+        parameters.mutate = tsp_path_mutate_2_opt;
+        parameters.destroy = path_destroy;
+        parameters.serialize = tsp_serialize_path;
+        parameters.deserialize = tsp_deserialize_path;
+        return parameters;
+}